@@ -0,0 +1,355 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache.h"
+
+/**
+ * Map a mode name given on the command line to its MODE_* value
+ * @param name: one of sc, dmc, fac or sac
+ * @return MODE_* value, -1 if name is not a known mode
+ */
+int cache_parse_mode(const char* name)
+{
+    if (strcmp(name, "sc") == 0)
+        return MODE_SC;
+    else if (strcmp(name, "dmc") == 0)
+        return MODE_DMC;
+    else if (strcmp(name, "fac") == 0)
+        return MODE_FAC;
+    else if (strcmp(name, "sac") == 0)
+        return MODE_SAC;
+    return -1;
+}
+
+/**
+ * Allocate and initialize the cache implementation selected by mode
+ * @param mode: one of MODE_SC, MODE_DMC, MODE_FAC or MODE_SAC
+ * @param mm: main memory
+ * @return initialized cache
+ */
+cache* cache_init(int mode, main_memory* mm)
+{
+    cache* result = malloc(sizeof(cache));
+    memset(result, 0, sizeof(cache));
+    result->mode = mode;
+    result->mm = mm;
+
+    if (mode == MODE_SC)
+        result->sc = sc_init(mm);
+    else if (mode == MODE_DMC)
+        result->dmc = dmc_init(mm);
+    else if (mode == MODE_FAC)
+        result->fac = fac_init(mm);
+    else if (mode == MODE_SAC)
+        result->sac = sac_init(mm);
+    return result;
+}
+
+/**
+ * Store val at addr (write query)
+ * @param c: pointer to cache
+ * @param addr: address where data is to be stored (always properly aligned)
+ * @param val: data
+ */
+void cache_store_word(cache* c, void* addr, unsigned int val)
+{
+    if (c->mode == MODE_SC)
+        sc_store_word(c->sc, addr, val);
+    else if (c->mode == MODE_DMC)
+        dmc_store_word(c->dmc, addr, val);
+    else if (c->mode == MODE_FAC)
+        fac_store_word(c->fac, addr, val);
+    else if (c->mode == MODE_SAC)
+        sac_store_word(c->sac, addr, val);
+}
+
+/**
+ * Read value at addr (read query)
+ * @param c: pointer to cache
+ * @param addr: address where data is stored
+ * @return val: data stored at addr
+ */
+unsigned int cache_load_word(cache* c, void* addr)
+{
+    if (c->mode == MODE_SC)
+        return sc_load_word(c->sc, addr);
+    else if (c->mode == MODE_DMC)
+        return dmc_load_word(c->dmc, addr);
+    else if (c->mode == MODE_FAC)
+        return fac_load_word(c->fac, addr);
+    return sac_load_word(c->sac, addr);
+}
+
+/**
+ * Mark the following accesses as non-temporal, or back to normal
+ */
+static void set_non_temporal(cache* c, int non_temporal)
+{
+    if (c->mode == MODE_DMC)
+        c->dmc->non_temporal = non_temporal;
+    else if (c->mode == MODE_FAC)
+        c->fac->non_temporal = non_temporal;
+    else if (c->mode == MODE_SAC)
+        c->sac->non_temporal = non_temporal;
+}
+
+/**
+ * Store val at addr without expecting reuse: a miss either bypasses the cache
+ * or fills at the LRU position, and a hit keeps its LRU position
+ * @param c: pointer to cache
+ * @param addr: address where data is to be stored (always properly aligned)
+ * @param val: data
+ */
+void cache_nt_store_word(cache* c, void* addr, unsigned int val)
+{
+    ++c->ops.nt_stores;
+    set_non_temporal(c, 1);
+    cache_store_word(c, addr, val);
+    set_non_temporal(c, 0);
+}
+
+/**
+ * Read value at addr without expecting reuse, see cache_nt_store_word
+ * @param c: pointer to cache
+ * @param addr: address where data is stored
+ * @return val: data stored at addr
+ */
+unsigned int cache_nt_load_word(cache* c, void* addr)
+{
+    ++c->ops.nt_loads;
+    set_non_temporal(c, 1);
+    unsigned int result = cache_load_word(c, addr);
+    set_non_temporal(c, 0);
+    return result;
+}
+
+/**
+ * Choose how non-temporal misses are placed
+ * @param c: pointer to cache
+ * @param policy: NT_INSERT_LRU or NT_BYPASS
+ */
+void cache_set_nt_policy(cache* c, int policy)
+{
+    if (c->mode == MODE_DMC)
+        c->dmc->nt_policy = policy;
+    else if (c->mode == MODE_FAC)
+        c->fac->nt_policy = policy;
+    else if (c->mode == MODE_SAC)
+        c->sac->nt_policy = policy;
+}
+
+/**
+ * Clean and/or invalidate the line holding addr; the simple cache holds no lines
+ * @param c: pointer to cache
+ * @param op: MAINT_CLEAN, MAINT_INVALIDATE or MAINT_CLEAN_INVALIDATE
+ * @param addr: any address in the block
+ */
+void cache_maintain(cache* c, int op, void* addr)
+{
+    unsigned int w_queries = c->mm->w_queries;
+    unsigned int w_bytes = c->mm->w_bytes;
+    if (op == MAINT_CLEAN)
+        ++c->ops.cleans;
+    else if (op == MAINT_INVALIDATE)
+        ++c->ops.invalidates;
+    else
+        ++c->ops.clean_invalidates;
+
+    if (c->mode == MODE_DMC)
+        dmc_maintain(c->dmc, op, addr);
+    else if (c->mode == MODE_FAC)
+        fac_maintain(c->fac, op, addr);
+    else if (c->mode == MODE_SAC)
+        sac_maintain(c->sac, op, addr);
+    c->ops.maint_w_queries += c->mm->w_queries - w_queries;
+    c->ops.maint_w_bytes += c->mm->w_bytes - w_bytes;
+}
+
+/**
+ * Write back every dirty line and invalidate the whole cache
+ * @param c: pointer to cache
+ */
+void cache_flush(cache* c)
+{
+    unsigned int w_queries = c->mm->w_queries;
+    unsigned int w_bytes = c->mm->w_bytes;
+    ++c->ops.flushes;
+
+    if (c->mode == MODE_DMC)
+        dmc_flush(c->dmc);
+    else if (c->mode == MODE_FAC)
+        fac_flush(c->fac);
+    else if (c->mode == MODE_SAC)
+        sac_flush(c->sac);
+    c->ops.maint_w_queries += c->mm->w_queries - w_queries;
+    c->ops.maint_w_bytes += c->mm->w_bytes - w_bytes;
+}
+
+/**
+ * Apply one trace record
+ * @param c: pointer to cache
+ * @param RW: R, W or I access, L or S non-temporal load or store, C clean,
+ *            V invalidate, X clean and invalidate, F flush
+ * @param addr: address accessed, ignored for F
+ * @param val: data for W and S
+ * @return value read for loads, val otherwise
+ */
+unsigned int cache_access(cache* c, char RW, void* addr, unsigned int val)
+{
+    if (RW == 'W')
+        cache_store_word(c, addr, val);
+    else if (RW == 'S')
+        cache_nt_store_word(c, addr, val);
+    else if (RW == 'L')
+        return cache_nt_load_word(c, addr);
+    else if (RW == 'C')
+        cache_maintain(c, MAINT_CLEAN, addr);
+    else if (RW == 'V')
+        cache_maintain(c, MAINT_INVALIDATE, addr);
+    else if (RW == 'X')
+        cache_maintain(c, MAINT_CLEAN_INVALIDATE, addr);
+    else if (RW == 'F')
+        cache_flush(c);
+    else
+        return cache_load_word(c, addr);
+    return val;
+}
+
+/**
+ * Access statistics of the underlying cache
+ * @param c: pointer to cache
+ * @return pointer to the statistics kept by the selected implementation
+ */
+cache_stats* cache_get_stats(cache* c)
+{
+    if (c->mode == MODE_SC)
+        return &c->sc->cs;
+    else if (c->mode == MODE_DMC)
+        return &c->dmc->cs;
+    else if (c->mode == MODE_FAC)
+        return &c->fac->cs;
+    return &c->sac->cs;
+}
+
+/**
+ * Number of sets that can be indexed with cache_set_index
+ * @param c: pointer to cache
+ * @return number of sets, 0 if the cache does not index sets (sc, fac)
+ */
+int cache_num_sets(cache* c)
+{
+    if (c->mode == MODE_DMC)
+        return DIRECT_MAPPED_NUM_SETS;
+    else if (c->mode == MODE_SAC)
+        return SET_ASSOCIATIVE_NUM_SETS;
+    return 0;
+}
+
+/**
+ * Compute set index of addr
+ * @param c: pointer to cache
+ * @param addr: full address
+ * @return index of the set addr maps to, -1 if the cache does not index sets
+ */
+int cache_set_index(cache* c, void* addr)
+{
+    if (c->mode == MODE_DMC)
+        return dmc_set_index(c->dmc, addr);
+    else if (c->mode == MODE_SAC)
+        return sac_set_index(c->sac, addr);
+    return -1;
+}
+
+/**
+ * Select the function mapping blocks to sets (dmc, sac)
+ * @param c: pointer to cache
+ * @param index_fn: INDEX_* value; INDEX_SKEWED is only valid for sac
+ */
+void cache_set_index_fn(cache* c, int index_fn)
+{
+    if (c->mode == MODE_DMC)
+        c->dmc->index_fn = index_fn;
+    else if (c->mode == MODE_SAC)
+        c->sac->index_fn = index_fn;
+}
+
+/**
+ * Attach a self-profiler that the engine reports its fill and update phases to
+ * @param c: pointer to cache
+ * @param sp: profiler, NULL to detach
+ */
+void cache_set_profiler(cache* c, selfprof* sp)
+{
+    if (c->mode == MODE_SC)
+        c->sc->prof = sp;
+    else if (c->mode == MODE_DMC)
+        c->dmc->prof = sp;
+    else if (c->mode == MODE_FAC)
+        c->fac->prof = sp;
+    else if (c->mode == MODE_SAC)
+        c->sac->prof = sp;
+}
+
+/**
+ * Attach a hotness profiler that is told about every eviction; the simple
+ * cache never evicts
+ * @param c: pointer to cache
+ * @param hp: profiler, or NULL to detach
+ */
+void cache_set_hotness(cache* c, hotness* hp)
+{
+    if (c->mode == MODE_DMC)
+        c->dmc->hot = hp;
+    else if (c->mode == MODE_FAC)
+        c->fac->hot = hp;
+    else if (c->mode == MODE_SAC)
+        c->sac->hot = hp;
+}
+
+/**
+ * Per-set access, miss and eviction counters
+ * @param c: pointer to cache
+ * @return array of cache_num_sets(c) entries, NULL if the cache does not index sets
+ */
+set_stats* cache_set_hist(cache* c)
+{
+    if (c->mode == MODE_DMC)
+        return c->dmc->set_hist;
+    else if (c->mode == MODE_SAC)
+        return c->sac->set_hist;
+    return NULL;
+}
+
+/**
+ * Number of valid lines currently held by a set
+ * @param c: pointer to cache
+ * @param set_index: set
+ * @return number of valid lines
+ */
+int cache_set_occupancy(cache* c, int set_index)
+{
+    if (c->mode == MODE_DMC)
+        return c->dmc->cache_set[set_index].is_valid == 1;
+
+    int result = 0;
+    for (int i = 0; i < SET_ASSOCIATIVE_NUM_WAYS; i++)
+        result += c->sac->cache_set[set_index].ways[i].is_valid == 1;
+    return result;
+}
+
+/**
+ * Free memory allocated to cache (main memory is not free'd)
+ * @param c: pointer to cache
+ */
+void cache_free(cache* c)
+{
+    if (c->mode == MODE_SC)
+        sc_free(c->sc);
+    else if (c->mode == MODE_DMC)
+        dmc_free(c->dmc);
+    else if (c->mode == MODE_FAC)
+        fac_free(c->fac);
+    else if (c->mode == MODE_SAC)
+        sac_free(c->sac);
+    free(c);
+}
@@ -0,0 +1,66 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "main_memory.h"
+#include "cache_stats.h"
+#include "simple.h"
+#include "direct_mapped.h"
+#include "fully_associative.h"
+#include "set_associative.h"
+#include "cache_ops.h"
+
+#define MODE_SC 0
+#define MODE_DMC 1
+#define MODE_FAC 2
+#define MODE_SAC 3
+
+typedef struct cache
+{
+    int mode;
+    simple_cache* sc;
+    direct_mapped_cache* dmc;
+    fully_associative_cache* fac;
+    set_associative_cache* sac;
+    main_memory* mm;
+    cache_op_stats ops;
+} cache;
+
+int cache_parse_mode(const char* name);
+
+cache* cache_init(int mode, main_memory* mm);
+
+void cache_store_word(cache* c, void* addr, unsigned int val);
+
+unsigned int cache_load_word(cache* c, void* addr);
+
+void cache_nt_store_word(cache* c, void* addr, unsigned int val);
+
+unsigned int cache_nt_load_word(cache* c, void* addr);
+
+void cache_set_nt_policy(cache* c, int policy);
+
+void cache_maintain(cache* c, int op, void* addr);
+
+void cache_flush(cache* c);
+
+unsigned int cache_access(cache* c, char RW, void* addr, unsigned int val);
+
+cache_stats* cache_get_stats(cache* c);
+
+int cache_num_sets(cache* c);
+
+int cache_set_index(cache* c, void* addr);
+
+void cache_set_index_fn(cache* c, int index_fn);
+
+void cache_set_profiler(cache* c, selfprof* sp);
+
+void cache_set_hotness(cache* c, hotness* hp);
+
+set_stats* cache_set_hist(cache* c);
+
+int cache_set_occupancy(cache* c, int set_index);
+
+void cache_free(cache* c);
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef CACHE_OPS_H
+#define CACHE_OPS_H
+
+// Placement of a non-temporal access that misses
+#define NT_INSERT_LRU 0
+#define NT_BYPASS 1
+
+// Maintenance of one block; a flush cleans and invalidates every line
+#define MAINT_CLEAN 1
+#define MAINT_INVALIDATE 2
+#define MAINT_CLEAN_INVALIDATE (MAINT_CLEAN | MAINT_INVALIDATE)
+
+// Non-temporal and maintenance records seen by one cache, with the memory
+// writes that maintenance caused
+typedef struct cache_op_stats
+{
+    unsigned int nt_loads;
+    unsigned int nt_stores;
+    unsigned int cleans;
+    unsigned int invalidates;
+    unsigned int clean_invalidates;
+    unsigned int flushes;
+    unsigned int maint_w_queries;
+    unsigned int maint_w_bytes;
+} cache_op_stats;
+
+#endif
@@ -1,6 +1,9 @@
 #ifndef CACHE_STATS_H
 #define CACHE_STATS_H
 
+// LRU usage counts are halved whenever the query count reaches a multiple of this
+#define NEARING_OVERFLOW 2147483640
+
 typedef struct cache_stats
 {
     unsigned int w_queries;
@@ -9,6 +12,13 @@ typedef struct cache_stats
     unsigned int r_misses;
 } cache_stats;
 
+typedef struct set_stats
+{
+    unsigned int queries;
+    unsigned int misses;
+    unsigned int evictions;
+} set_stats;
+
 cache_stats cs_init();
 
 #endif
\ No newline at end of file
@@ -0,0 +1,311 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "memory_block.h"
+#include "checkpoint.h"
+
+/**
+ * Pointers to the state of a single cache line, independent of cache type
+ */
+typedef struct line_ref
+{
+    int* is_valid;
+    int* is_dirty;
+    unsigned int* valid_mask;
+    unsigned int* dirty_mask;
+    memory_block** mem_block;
+    float* usage;
+} line_ref;
+
+/**
+ * Number of lines held by the cache
+ * @param c: pointer to cache
+ * @return number of lines, 0 for the simple cache
+ */
+static unsigned int num_lines(cache* c)
+{
+    if (c->mode == MODE_DMC)
+        return DIRECT_MAPPED_NUM_SETS;
+    else if (c->mode == MODE_FAC)
+        return FULLY_ASSOCIATIVE_NUM_WAYS;
+    else if (c->mode == MODE_SAC)
+        return SET_ASSOCIATIVE_NUM_SETS * SET_ASSOCIATIVE_NUM_WAYS;
+    return 0;
+}
+
+/**
+ * Number of fill counters (ways in use) kept by the cache
+ * @param c: pointer to cache
+ * @return number of counters
+ */
+static unsigned int num_fills(cache* c)
+{
+    if (c->mode == MODE_FAC)
+        return 1;
+    else if (c->mode == MODE_SAC)
+        return SET_ASSOCIATIVE_NUM_SETS;
+    return 0;
+}
+
+/**
+ * Set index function in use, which must match between save and restore
+ * @param c: pointer to cache
+ * @return INDEX_* value
+ */
+static int index_fn(cache* c)
+{
+    if (c->mode == MODE_DMC)
+        return c->dmc->index_fn;
+    else if (c->mode == MODE_SAC)
+        return c->sac->index_fn;
+    return INDEX_MODULO;
+}
+
+/**
+ * Whether lines keep per-sector valid and dirty bits, which must also match
+ * @param c: pointer to cache
+ * @return 1 for a sectored sac
+ */
+static int is_sectored(cache* c)
+{
+    return c->mode == MODE_SAC && c->sac->sectored;
+}
+
+/**
+ * Locate fill counter i
+ * @param c: pointer to cache
+ * @param i: counter index, smaller than num_fills(c)
+ * @return pointer to counter
+ */
+static int* fill_ref(cache* c, unsigned int i)
+{
+    if (c->mode == MODE_FAC)
+        return &c->fac->num_sets;
+    return &c->sac->cache_set[i].num_ways;
+}
+
+/**
+ * Locate line i; sac lines are numbered set by set
+ * @param c: pointer to cache
+ * @param i: line index, smaller than num_lines(c)
+ * @return references to line state (NULL for state the cache does not track)
+ */
+static line_ref get_line(cache* c, unsigned int i)
+{
+    line_ref result;
+    if (c->mode == MODE_DMC)
+    {
+        direct_map_set* line = &c->dmc->cache_set[i];
+        result.is_valid = &line->is_valid;
+        result.is_dirty = &line->is_dirty;
+        result.mem_block = &line->mem_block;
+        result.valid_mask = NULL;
+        result.dirty_mask = NULL;
+        result.usage = NULL;
+    }
+    else if (c->mode == MODE_FAC)
+    {
+        fully_assoc_set* line = &c->fac->cache_set[i];
+        result.is_valid = &line->is_valid;
+        result.is_dirty = &line->is_dirty;
+        result.mem_block = &line->mem_block;
+        result.valid_mask = NULL;
+        result.dirty_mask = NULL;
+        result.usage = &c->fac->usage[i];
+    }
+    else
+    {
+        sac_map_set* set = &c->sac->cache_set[i / SET_ASSOCIATIVE_NUM_WAYS];
+        sac_map_way* line = &set->ways[i % SET_ASSOCIATIVE_NUM_WAYS];
+        result.is_valid = &line->is_valid;
+        result.is_dirty = &line->is_dirty;
+        result.mem_block = &line->mem_block;
+        result.valid_mask = &line->valid_mask;
+        result.dirty_mask = &line->dirty_mask;
+        result.usage = &set->usage[i % SET_ASSOCIATIVE_NUM_WAYS];
+    }
+    return result;
+}
+
+/**
+ * Write cache, statistics and main memory state to a binary snapshot
+ * Layout: header, main memory image, fill counters, line records
+ * @param path: snapshot file to create
+ * @param c: pointer to cache
+ * @param mm: main memory backing the cache
+ * @param trace_offset: byte offset in the trace where simulation resumes
+ * @param trace_line: number of trace lines consumed so far
+ */
+void ckpt_save(const char* path, cache* c, main_memory* mm,
+               long trace_offset, unsigned int trace_line)
+{
+    FILE* output_file = fopen(path, "wb");
+    if (output_file == 0)
+    {
+        fprintf(stderr, "Error: Could not create checkpoint %s.\n", path);
+        exit(1);
+    }
+
+    checkpoint_header header;
+    memset(&header, 0, sizeof(header));
+    header.magic = CHECKPOINT_MAGIC;
+    header.version = CHECKPOINT_VERSION;
+    header.mode = c->mode;
+    header.index_fn = index_fn(c);
+    header.sectored = is_sectored(c);
+    header.block_size = MAIN_MEMORY_BLOCK_SIZE;
+    header.mm_size = MAIN_MEMORY_SIZE;
+    header.num_fills = num_fills(c);
+    header.num_lines = num_lines(c);
+    header.mm_w_queries = mm->w_queries;
+    header.mm_r_queries = mm->r_queries;
+    header.mm_w_bytes = mm->w_bytes;
+    header.mm_r_bytes = mm->r_bytes;
+    header.cs = *cache_get_stats(c);
+    header.ops = c->ops;
+    if (c->mode == MODE_SAC)
+        memcpy(header.tenant_cs, c->sac->tenant_cs, sizeof(header.tenant_cs));
+    header.trace_offset = trace_offset;
+    header.trace_line = trace_line;
+
+    int ok = fwrite(&header, sizeof(header), 1, output_file) == 1
+             && fwrite(mm->data, MAIN_MEMORY_SIZE, 1, output_file) == 1;
+
+    for (unsigned int i = 0; ok && i < header.num_fills; i++)
+    {
+        int32_t fill = *fill_ref(c, i);
+        ok = fwrite(&fill, sizeof(fill), 1, output_file) == 1;
+    }
+
+    for (unsigned int i = 0; ok && i < header.num_lines; i++)
+    {
+        line_ref line = get_line(c, i);
+        checkpoint_line record;
+        memset(&record, 0, sizeof(record));
+        record.start_addr = (uint32_t) (uintptr_t) (*line.mem_block)->start_addr;
+        record.is_valid = *line.is_valid;
+        record.is_dirty = *line.is_dirty;
+        record.valid_mask = line.valid_mask ? *line.valid_mask : 0;
+        record.dirty_mask = line.dirty_mask ? *line.dirty_mask : 0;
+        record.usage = line.usage ? *line.usage : 0;
+        if ((*line.mem_block)->data != NULL)
+            memcpy(record.data, (*line.mem_block)->data, MAIN_MEMORY_BLOCK_SIZE);
+        ok = fwrite(&record, sizeof(record), 1, output_file) == 1;
+    }
+
+    if (fclose(output_file) != 0 || !ok)
+    {
+        fprintf(stderr, "Error: Could not write checkpoint %s.\n", path);
+        exit(2);
+    }
+}
+
+/**
+ * Restore cache, statistics and main memory state from a snapshot written by
+ * ckpt_save. The snapshot is mapped rather than read, so restoring costs one
+ * copy of the memory image plus the (small) line array.
+ * @param path: snapshot file
+ * @param c: pointer to freshly initialized cache of the same mode
+ * @param mm: main memory backing the cache
+ * @param trace_offset: set to byte offset in the trace where simulation resumes
+ * @param trace_line: set to number of trace lines consumed before the snapshot
+ */
+void ckpt_restore(const char* path, cache* c, main_memory* mm,
+                  long* trace_offset, unsigned int* trace_line)
+{
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0)
+    {
+        fprintf(stderr, "Error: Could not open checkpoint %s.\n", path);
+        exit(1);
+    }
+
+    size_t expected_size = sizeof(checkpoint_header) + MAIN_MEMORY_SIZE
+                           + num_fills(c) * sizeof(int32_t)
+                           + num_lines(c) * sizeof(checkpoint_line);
+    if ((size_t) st.st_size != expected_size)
+    {
+        fprintf(stderr, "Error: Checkpoint %s does not match this cache"
+                        " configuration.\n", path);
+        exit(2);
+    }
+
+    void* image = mmap(NULL, expected_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED)
+    {
+        fprintf(stderr, "Error: Could not map checkpoint %s.\n", path);
+        exit(1);
+    }
+
+    const checkpoint_header* header = image;
+    if (header->magic != CHECKPOINT_MAGIC || header->version != CHECKPOINT_VERSION
+        || header->mode != c->mode || header->index_fn != index_fn(c) || header->sectored != is_sectored(c)
+        || header->block_size != MAIN_MEMORY_BLOCK_SIZE
+        || header->mm_size != MAIN_MEMORY_SIZE || header->num_fills != num_fills(c)
+        || header->num_lines != num_lines(c))
+    {
+        fprintf(stderr, "Error: Checkpoint %s does not match this cache"
+                        " configuration.\n", path);
+        exit(2);
+    }
+
+    const unsigned char* cursor = (const unsigned char*) image + sizeof(checkpoint_header);
+    memcpy(mm->data, cursor, MAIN_MEMORY_SIZE);
+    cursor += MAIN_MEMORY_SIZE;
+    mm->w_queries = header->mm_w_queries;
+    mm->r_queries = header->mm_r_queries;
+    mm->w_bytes = header->mm_w_bytes;
+    mm->r_bytes = header->mm_r_bytes;
+    *cache_get_stats(c) = header->cs;
+    c->ops = header->ops;
+    if (c->mode == MODE_SAC)
+        memcpy(c->sac->tenant_cs, header->tenant_cs, sizeof(header->tenant_cs));
+
+    for (unsigned int i = 0; i < header->num_fills; i++)
+    {
+        int32_t fill;
+        memcpy(&fill, cursor, sizeof(fill));
+        *fill_ref(c, i) = fill;
+        cursor += sizeof(fill);
+    }
+
+    const checkpoint_line* records = (const checkpoint_line*) cursor;
+    for (unsigned int i = 0; i < header->num_lines; i++)
+    {
+        line_ref line = get_line(c, i);
+        void* start_addr = (void*) (uintptr_t) records[i].start_addr;
+
+        mb_free(*line.mem_block);
+        if (records[i].is_valid)
+            *line.mem_block = mb_new(start_addr, MAIN_MEMORY_BLOCK_SIZE,
+                                     (void*) records[i].data);
+        else
+        {
+            // Invalid lines keep the dummy block set up by the init functions
+            *line.mem_block = malloc(sizeof(memory_block));
+            (*line.mem_block)->data = NULL;
+            (*line.mem_block)->size = MAIN_MEMORY_BLOCK_SIZE;
+            (*line.mem_block)->start_addr = start_addr;
+        }
+        *line.is_valid = records[i].is_valid;
+        *line.is_dirty = records[i].is_dirty;
+        if (line.valid_mask)
+            *line.valid_mask = records[i].valid_mask;
+        if (line.dirty_mask)
+            *line.dirty_mask = records[i].dirty_mask;
+        if (line.usage)
+            *line.usage = records[i].usage;
+    }
+
+    *trace_offset = header->trace_offset;
+    *trace_line = header->trace_line;
+    munmap(image, expected_size);
+}
@@ -0,0 +1,51 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+
+#include "cache.h"
+
+#define CHECKPOINT_MAGIC 0x54504b43
+#define CHECKPOINT_VERSION 6
+
+typedef struct checkpoint_header
+{
+    uint32_t magic;
+    uint32_t version;
+    int32_t mode;
+    int32_t index_fn;
+    int32_t sectored;
+    uint32_t block_size;
+    uint32_t mm_size;
+    uint32_t num_fills;
+    uint32_t num_lines;
+    uint32_t mm_w_queries;
+    uint32_t mm_r_queries;
+    uint32_t mm_w_bytes;
+    uint32_t mm_r_bytes;
+    cache_stats cs;
+    cache_op_stats ops;
+    // Per-tenant statistics of a sac, zero for other caches
+    cache_stats tenant_cs[SET_ASSOCIATIVE_MAX_TENANTS];
+    int64_t trace_offset;
+    uint32_t trace_line;
+} checkpoint_header;
+
+typedef struct checkpoint_line
+{
+    uint32_t start_addr;
+    int32_t is_valid;
+    int32_t is_dirty;
+    uint32_t valid_mask;
+    uint32_t dirty_mask;
+    float usage;
+    unsigned char data[MAIN_MEMORY_BLOCK_SIZE];
+} checkpoint_line;
+
+void ckpt_save(const char* path, cache* c, main_memory* mm,
+               long trace_offset, unsigned int trace_line);
+
+void ckpt_restore(const char* path, cache* c, main_memory* mm,
+                  long* trace_offset, unsigned int* trace_line);
+
+#endif
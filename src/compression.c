@@ -0,0 +1,248 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "compression.h"
+
+/**
+ * Read a little-endian signed value of k bytes
+ * @param p: source
+ * @param k: width in bytes (1, 2, 4 or 8)
+ * @return sign-extended value
+ */
+static int64_t read_value(const unsigned char* p, int k)
+{
+    uint64_t result = 0;
+    for (int i = k - 1; i >= 0; i--)
+        result = (result << 8) | p[i];
+    if (k < 8 && (result >> (8 * k - 1)) & 1)
+        result |= ~0ull << (8 * k);
+    return (int64_t) result;
+}
+
+/**
+ * Check whether v fits in a d-byte signed integer
+ */
+static int fits(int64_t v, int d)
+{
+    int64_t limit = 1ll << (8 * d - 1);
+    return v >= -limit && v < limit;
+}
+
+/**
+ * Base-delta-immediate size for k-byte values with d-byte deltas, using an
+ * implicit zero base plus one explicit base (the first value far from zero)
+ * @param data: line contents
+ * @param size: line size in bytes
+ * @param k: value width
+ * @param d: delta width, smaller than k
+ * @return compressed size in bytes, size if the line does not fit this encoding
+ */
+static int bdi_size(const unsigned char* data, int size, int k, int d)
+{
+    int n = size / k;
+    int has_base = 0;
+    int64_t base = 0;
+    for (int i = 0; i < n; i++)
+    {
+        int64_t v = read_value(data + i * k, k);
+        if (fits(v, d))
+            continue;
+        if (!has_base)
+        {
+            has_base = 1;
+            base = v;
+        }
+        if (!fits((int64_t) ((uint64_t) v - (uint64_t) base), d))
+            return size;
+    }
+    // base, one delta per value and a bit per value selecting its base
+    return k + n * d + (n + 7) / 8;
+}
+
+/**
+ * Frequent pattern compression size: a 3-bit prefix per 32-bit word followed
+ * by the pattern payload
+ * @param data: line contents
+ * @param size: line size in bytes
+ * @return compressed size in bytes
+ */
+static int fpc_size(const unsigned char* data, int size)
+{
+    int bits = 0;
+    for (int i = 0; i + 4 <= size; i += 4)
+    {
+        int32_t w = (int32_t) read_value(data + i, 4);
+        int16_t lo = (int16_t) (w & 0xffff), hi = (int16_t) (w >> 16);
+        bits += 3;
+        if (w == 0)
+            continue;
+        else if (w >= -8 && w < 8)
+            bits += 4;
+        else if (w >= -128 && w < 128)
+            bits += 8;
+        else if (w >= -32768 && w < 32768)
+            bits += 16;
+        else if (lo == 0)
+            bits += 16;
+        else if (lo >= -128 && lo < 128 && hi >= -128 && hi < 128)
+            bits += 16;
+        else if (data[i] == data[i + 1] && data[i] == data[i + 2] && data[i] == data[i + 3])
+            bits += 8;
+        else
+            bits += 32;
+    }
+    return (bits + 7) / 8;
+}
+
+/**
+ * Compressed size of a line, choosing the smallest of zero-block,
+ * repeated-value, BDI and FPC encodings, rounded up to whole segments
+ * @param data: line contents
+ * @param size: line size in bytes
+ * @param encoding: set to the COMPRESSION_* encoding chosen
+ * @return compressed size in bytes, at most size
+ */
+int compress_size(const void* data, int size, int* encoding)
+{
+    const unsigned char* bytes = data;
+    int zero = 1, repeat = 1;
+    for (int i = 0; i < size; i++)
+    {
+        zero &= bytes[i] == 0;
+        repeat &= bytes[i] == bytes[i % 8];
+    }
+
+    int best = size;
+    *encoding = COMPRESSION_NONE;
+    if (zero)
+    {
+        best = 1;
+        *encoding = COMPRESSION_ZERO;
+    }
+    else if (repeat)
+    {
+        best = 8;
+        *encoding = COMPRESSION_REPEAT;
+    }
+    else
+    {
+        static const int configs[][2] = { { 8, 1 }, { 8, 2 }, { 8, 4 }, { 4, 1 }, { 4, 2 }, { 2, 1 } };
+        for (int i = 0; i < (int) (sizeof(configs) / sizeof(configs[0])); i++)
+        {
+            int s = bdi_size(bytes, size, configs[i][0], configs[i][1]);
+            if (s < best)
+            {
+                best = s;
+                *encoding = COMPRESSION_BDI;
+            }
+        }
+        int s = fpc_size(bytes, size);
+        if (s < best)
+        {
+            best = s;
+            *encoding = COMPRESSION_FPC;
+        }
+    }
+
+    best = (best + COMPRESSION_SEGMENT_SIZE - 1) / COMPRESSION_SEGMENT_SIZE * COMPRESSION_SEGMENT_SIZE;
+    if (best >= size)
+    {
+        *encoding = COMPRESSION_NONE;
+        return size;
+    }
+    return best;
+}
+
+/**
+ * Cycles needed to decompress a line
+ * @param encoding: COMPRESSION_* encoding
+ * @return latency in cycles
+ */
+int compress_latency(int encoding)
+{
+    static const int latencies[] = COMPRESSION_LATENCIES;
+    return latencies[encoding];
+}
+
+/**
+ * Allocate compression statistics, including an uncompressed LRU tag array
+ * of the same geometry used as the hit-rate baseline
+ * @param num_sets: number of sets
+ * @param num_ways: ways of the uncompressed cache
+ * @return initialized statistics
+ */
+compression_stats* comp_stats_init(int num_sets, int num_ways)
+{
+    compression_stats* result = calloc(1, sizeof(compression_stats));
+    result->num_sets = num_sets;
+    result->num_ways = num_ways;
+    result->base_tags = malloc(num_sets * num_ways * sizeof(uint32_t));
+    result->base_depth = calloc(num_sets, sizeof(int));
+    return result;
+}
+
+/**
+ * Replay an access on the uncompressed baseline
+ * @param cs: pointer to statistics
+ * @param set_index: set the access maps to
+ * @param block: block number
+ */
+void comp_baseline_access(compression_stats* cs, int set_index, uint32_t block)
+{
+    uint32_t* stack = cs->base_tags + set_index * cs->num_ways;
+    int* depth = &cs->base_depth[set_index];
+    cs->base_queries++;
+
+    int pos = 0;
+    while (pos < *depth && stack[pos] != block)
+        pos++;
+    if (pos < *depth)
+        cs->base_hits++;
+    else if (*depth < cs->num_ways)
+        (*depth)++;
+    else
+        pos = cs->num_ways - 1;
+
+    memmove(stack + 1, stack, pos * sizeof(uint32_t));
+    stack[0] = block;
+}
+
+/**
+ * Print compression ratio, effective capacity and hit rate against the baseline
+ * @param cs: pointer to statistics
+ * @param compressed: statistics of the compressed cache
+ */
+void comp_print(compression_stats* cs, cache_stats* compressed)
+{
+    static const char* names[] = { "none", "zero", "repeat", "bdi", "fpc" };
+    unsigned int queries = compressed->w_queries + compressed->r_queries;
+    unsigned int hits = queries - compressed->w_misses - compressed->r_misses;
+    double hit_rate = queries ? (double) hits / queries * 100 : 0;
+    double base_rate = cs->base_queries ? (double) cs->base_hits / cs->base_queries * 100 : 0;
+    double avg_lines = cs->samples ? (double) cs->valid_line_sum / cs->samples : 0;
+
+    printf("Avg Compressed Size:\t%.1lf bytes\n",
+           cs->fills ? (double) cs->fill_bytes / cs->fills : 0);
+    printf("Encodings:\t\t");
+    for (int i = 0; i < COMPRESSION_NUM_ENCODINGS; i++)
+        printf("%s %u%s", names[i], cs->encodings[i],
+               i + 1 < COMPRESSION_NUM_ENCODINGS ? ", " : "\n");
+    printf("Effective Capacity:\t%.2lfx (%.1lf lines resident)\n",
+           avg_lines / (cs->num_sets * cs->num_ways), avg_lines);
+    printf("Decompression Cycles:\t%lu\n", cs->decompress_cycles);
+    printf("Hit Rate vs Baseline:\t%.1lf%% vs %.1lf%% (%+.1lf)\n",
+           hit_rate, base_rate, hit_rate - base_rate);
+    printf("*******************************************\n");
+}
+
+/**
+ * Free memory allocated to statistics
+ * @param cs: pointer to statistics
+ */
+void comp_stats_free(compression_stats* cs)
+{
+    free(cs->base_tags);
+    free(cs->base_depth);
+    free(cs);
+}
@@ -0,0 +1,51 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <stdint.h>
+
+#include "cache_stats.h"
+
+#define COMPRESSION_SEGMENT_SIZE 8
+
+#define COMPRESSION_NONE 0
+#define COMPRESSION_ZERO 1
+#define COMPRESSION_REPEAT 2
+#define COMPRESSION_BDI 3
+#define COMPRESSION_FPC 4
+#define COMPRESSION_NUM_ENCODINGS 5
+
+// Decompression latency in cycles per encoding, indexed by COMPRESSION_*
+#define COMPRESSION_LATENCIES { 0, 0, 1, 1, 5 }
+
+typedef struct compression_stats
+{
+    unsigned int fills;
+    unsigned long fill_bytes;
+    unsigned int encodings[COMPRESSION_NUM_ENCODINGS];
+    unsigned long decompress_cycles;
+    unsigned int valid_lines;
+    unsigned long valid_line_sum;
+    unsigned int samples;
+
+    // Uncompressed cache of the same geometry, as LRU stacks of block numbers
+    int num_sets;
+    int num_ways;
+    uint32_t* base_tags;
+    int* base_depth;
+    unsigned int base_queries;
+    unsigned int base_hits;
+} compression_stats;
+
+int compress_size(const void* data, int size, int* encoding);
+
+int compress_latency(int encoding);
+
+compression_stats* comp_stats_init(int num_sets, int num_ways);
+
+void comp_baseline_access(compression_stats* cs, int set_index, uint32_t block);
+
+void comp_print(compression_stats* cs, cache_stats* compressed);
+
+void comp_stats_free(compression_stats* cs);
+
+#endif
@@ -0,0 +1,221 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "differential.h"
+#include "set_index.h"
+
+/**
+ * Build configuration B from a spec: a mode followed by comma-separated
+ * options index=FN, ways=N (sac), sectored (sac), compressed (sac) and
+ * nt=lru|bypass. Options not given keep their defaults.
+ * @param spec: configuration, e.g. "sac,ways=1" or "dmc,index=xor"
+ * @param mm: main memory of configuration B
+ * @return cache, NULL if the spec is malformed or inconsistent
+ */
+static cache* build_cache(const char* spec, main_memory* mm)
+{
+    char* copy = strdup(spec);
+    char* save;
+    char* token = strtok_r(copy, ",", &save);
+    int mode = token ? cache_parse_mode(token) : -1;
+    int index_fn = INDEX_MODULO, ways = 0, sectored = 0, compressed = 0, nt_policy = NT_INSERT_LRU;
+    int valid = mode != -1;
+
+    while (valid && (token = strtok_r(NULL, ",", &save)) != NULL)
+    {
+        if (strncmp(token, "index=", 6) == 0)
+            valid = (index_fn = idx_parse(token + 6)) != -1;
+        else if (strncmp(token, "ways=", 5) == 0)
+        {
+            ways = atoi(token + 5);
+            valid = ways >= 1 && ways <= SET_ASSOCIATIVE_NUM_WAYS;
+        }
+        else if (strcmp(token, "sectored") == 0)
+            sectored = 1;
+        else if (strcmp(token, "compressed") == 0)
+            compressed = 1;
+        else if (strcmp(token, "nt=lru") == 0)
+            nt_policy = NT_INSERT_LRU;
+        else if (strcmp(token, "nt=bypass") == 0)
+            nt_policy = NT_BYPASS;
+        else
+            valid = 0;
+    }
+    free(copy);
+
+    // The same restrictions as for configuration A on the command line
+    if (!valid || (index_fn != INDEX_MODULO && mode != MODE_DMC && mode != MODE_SAC)
+        || ((ways || sectored || compressed || index_fn == INDEX_SKEWED) && mode != MODE_SAC)
+        || (index_fn == INDEX_SKEWED && ways) || (compressed && (sectored || ways || index_fn == INDEX_SKEWED)))
+        return NULL;
+
+    cache* result = cache_init(mode, mm);
+    cache_set_index_fn(result, index_fn);
+    cache_set_nt_policy(result, nt_policy);
+    if (sectored)
+        result->sac->sectored = 1;
+    if (compressed)
+        sac_enable_compression(result->sac);
+    for (int t = 0; ways && t < SET_ASSOCIATIVE_MAX_TENANTS; t++)
+        sac_set_way_mask(result->sac, t, (1u << ways) - 1);
+    return result;
+}
+
+/**
+ * Allocate a differential simulation
+ * Configuration B runs in lockstep with the main cache A on the same decoded
+ * records, against its own copy of the memory image. Every access is
+ * classified as a hit or miss in both; accesses that miss in only one are
+ * divergences, counted per region and per interval of accesses
+ * @param spec: configuration B, see build_cache
+ * @param mm_path: memory image, NULL for mm_init.data
+ * @param region_size: bytes per region, a power of two
+ * @param interval: accesses per interval
+ * @return initialized simulation, NULL if spec is not a valid configuration
+ */
+diff_sim* diff_init(const char* spec, const char* mm_path, int region_size, unsigned long interval)
+{
+    main_memory* mm = mm_init(mm_path);
+    mm->verbose = 0;
+    cache* c = build_cache(spec, mm);
+    if (c == NULL)
+    {
+        mm_free(mm);
+        return NULL;
+    }
+
+    diff_sim* result = calloc(1, sizeof(diff_sim));
+    result->spec = strdup(spec);
+    result->mm = mm;
+    result->c = c;
+    while ((1 << result->region_shift) < region_size)
+        result->region_shift++;
+    result->region_a = calloc(MAIN_MEMORY_SIZE >> result->region_shift, sizeof(unsigned int));
+    result->region_b = calloc(MAIN_MEMORY_SIZE >> result->region_shift, sizeof(unsigned int));
+    result->interval = interval;
+    return result;
+}
+
+/**
+ * Also write every divergence to a file, one line per access: trace line,
+ * operation, address and the configuration that missed
+ * @param ds: pointer to simulation
+ * @param path: output file
+ */
+void diff_open_log(diff_sim* ds, const char* path)
+{
+    ds->log = fopen(path, "w");
+    if (ds->log == NULL)
+    {
+        fprintf(stderr, "Error: Could not open %s.\n", path);
+        exit(3);
+    }
+}
+
+/**
+ * Simulate a record in configuration B and compare the outcome with A
+ * @param ds: pointer to simulation
+ * @param RW, addr, val, tenant: trace record, already simulated in A
+ * @param a_miss: whether the record missed in A
+ * @param line_num: trace line of the record
+ */
+void diff_access(diff_sim* ds, char RW, void* addr, unsigned int val, int tenant, int a_miss,
+                 unsigned int line_num)
+{
+    cache_stats* cs = cache_get_stats(ds->c);
+    unsigned int misses = cs->w_misses + cs->r_misses;
+    if (ds->c->mode == MODE_SAC)
+        ds->c->sac->tenant = tenant;
+    cache_access(ds->c, RW, addr, val);
+
+    // Maintenance is applied to keep B in step but is not an access
+    if (strchr("CVXF", RW))
+        return;
+    int b_miss = cs->w_misses + cs->r_misses != misses;
+    unsigned long n = ds->accesses++ / ds->interval;
+    if (a_miss == b_miss)
+    {
+        if (a_miss)
+            ds->both_miss++;
+        else
+            ds->both_hit++;
+        return;
+    }
+
+    if (n >= ds->num_intervals)
+    {
+        ds->interval_a = realloc(ds->interval_a, (n + 1) * sizeof(unsigned int));
+        ds->interval_b = realloc(ds->interval_b, (n + 1) * sizeof(unsigned int));
+        memset(ds->interval_a + ds->num_intervals, 0, (n + 1 - ds->num_intervals) * sizeof(unsigned int));
+        memset(ds->interval_b + ds->num_intervals, 0, (n + 1 - ds->num_intervals) * sizeof(unsigned int));
+        ds->num_intervals = n + 1;
+    }
+    int region = ((uintptr_t) addr % MAIN_MEMORY_SIZE) >> ds->region_shift;
+    if (a_miss)
+    {
+        ds->a_only++;
+        ds->region_a[region]++;
+        ds->interval_a[n]++;
+    }
+    else
+    {
+        ds->b_only++;
+        ds->region_b[region]++;
+        ds->interval_b[n]++;
+    }
+    if (ds->log)
+        fprintf(ds->log, "%u\t%c\t%p\t%c\n", line_num, RW, addr, a_miss ? 'A' : 'B');
+}
+
+/**
+ * Print configuration B's totals, the outcome classes, and the regions and
+ * intervals where A and B diverged
+ * @param ds: pointer to simulation
+ */
+void diff_print(diff_sim* ds)
+{
+    cache_stats* cs = cache_get_stats(ds->c);
+    unsigned int queries = cs->w_queries + cs->r_queries;
+    unsigned int hits = queries - cs->w_misses - cs->r_misses;
+    printf("Configuration B:\t%s\n", ds->spec);
+    printf("B Total Hit Rate:\t%.0lf%% (%u/%u)\n", queries ? (double) hits / queries * 100 : 0, hits, queries);
+    printf("B Writes to MM:\t\t%u\n", ds->mm->w_queries);
+    printf("B Reads from MM:\t%u\n", ds->mm->r_queries);
+    printf("Both Hit:\t\t%u\n", ds->both_hit);
+    printf("Both Miss:\t\t%u\n", ds->both_miss);
+    printf("Miss in A Only:\t\t%u\n", ds->a_only);
+    printf("Miss in B Only:\t\t%u\n", ds->b_only);
+
+    printf("Region\tA Only\tB Only\n");
+    for (int i = 0; i < MAIN_MEMORY_SIZE >> ds->region_shift; i++)
+        if (ds->region_a[i] || ds->region_b[i])
+            printf("0x%x\t%u\t%u\n", i << ds->region_shift, ds->region_a[i], ds->region_b[i]);
+    printf("Access\tA Only\tB Only\n");
+    for (unsigned long i = 0; i < ds->num_intervals; i++)
+        if (ds->interval_a[i] || ds->interval_b[i])
+            printf("%lu\t%u\t%u\n", i * ds->interval, ds->interval_a[i], ds->interval_b[i]);
+    printf("*******************************************\n");
+}
+
+/**
+ * Free simulation, closing the divergence log
+ * @param ds: pointer to simulation
+ */
+void diff_free(diff_sim* ds)
+{
+    if (ds->log && (ferror(ds->log) || fclose(ds->log) != 0))
+    {
+        fprintf(stderr, "Error: Could not write the divergence log.\n");
+        exit(3);
+    }
+    cache_free(ds->c);
+    mm_free(ds->mm);
+    free(ds->region_a);
+    free(ds->region_b);
+    free(ds->interval_a);
+    free(ds->interval_b);
+    free(ds->spec);
+    free(ds);
+}
@@ -0,0 +1,49 @@
+#ifndef DIFFERENTIAL_H
+#define DIFFERENTIAL_H
+
+#include <stdio.h>
+
+#include "main_memory.h"
+#include "cache.h"
+
+// Default bytes per region and accesses per interval of the divergence tables
+#define DIFF_DEFAULT_REGION 4096
+#define DIFF_DEFAULT_INTERVAL 100000
+
+typedef struct diff_sim
+{
+    // Configuration B, with its own copy of main memory
+    char* spec;
+    main_memory* mm;
+    cache* c;
+
+    unsigned long accesses;
+    unsigned int both_hit;
+    unsigned int both_miss;
+    unsigned int a_only;
+    unsigned int b_only;
+
+    // Accesses that missed in A only and in B only, per region and per interval
+    int region_shift;
+    unsigned int* region_a;
+    unsigned int* region_b;
+    unsigned long interval;
+    unsigned long num_intervals;
+    unsigned int* interval_a;
+    unsigned int* interval_b;
+
+    FILE* log;
+} diff_sim;
+
+diff_sim* diff_init(const char* spec, const char* mm_path, int region_size, unsigned long interval);
+
+void diff_open_log(diff_sim* ds, const char* path);
+
+void diff_access(diff_sim* ds, char RW, void* addr, unsigned int val, int tenant, int a_miss,
+                 unsigned int line_num);
+
+void diff_print(diff_sim* ds);
+
+void diff_free(diff_sim* ds);
+
+#endif
@@ -15,6 +15,12 @@ direct_mapped_cache* dmc_init(main_memory* mm)
     result->mm = mm;
     result->cs = cs_init();
     result->cache_set = malloc(DIRECT_MAPPED_NUM_SETS * sizeof(direct_map_set));
+    result->index_fn = INDEX_MODULO;
+    result->set_hist = calloc(DIRECT_MAPPED_NUM_SETS, sizeof(set_stats));
+    result->prof = NULL;
+    result->hot = NULL;
+    result->non_temporal = 0;
+    result->nt_policy = NT_INSERT_LRU;
     for (int i = 0; i < DIRECT_MAPPED_NUM_SETS; i++)
     {
         result->cache_set[i].is_valid = 0;
@@ -31,13 +37,26 @@ direct_mapped_cache* dmc_init(main_memory* mm)
 
 /**
  * Compute index corresponding to block number
+ * @param dmc: pointer to cache
  * @param addr: full address
  * @return int index corresponding to block number
  */
-static int addr_to_set(void* addr)
+static int addr_to_set(direct_mapped_cache* dmc, void* addr)
 {
     unsigned int result = (unsigned int) (uintptr_t) addr;
-    return (result >> MAIN_MEMORY_BLOCK_SIZE_LN) & ((1 << DIRECT_MAPPED_NUM_SETS_LN) - 1);
+    return idx_block_to_set(dmc->index_fn, result >> MAIN_MEMORY_BLOCK_SIZE_LN,
+                            DIRECT_MAPPED_NUM_SETS_LN, 0);
+}
+
+/**
+ * Compute set index of addr, for callers outside the cache (e.g. set sampling)
+ * @param dmc: pointer to cache
+ * @param addr: full address
+ * @return int index of the set addr maps to
+ */
+int dmc_set_index(direct_mapped_cache* dmc, void* addr)
+{
+    return addr_to_set(dmc, addr);
 }
 
 /**
@@ -54,15 +73,38 @@ void dmc_store_word(direct_mapped_cache* dmc, void* addr, unsigned int val)
     size_t addr_offt = (size_t) (addr - MAIN_MEMORY_START_ADDR) % MAIN_MEMORY_BLOCK_SIZE;
     void* mb_start_addr = addr - addr_offt;
 
-    int index = addr_to_set(mb_start_addr);
+    // Tags are full block numbers, since hashed indexing does not keep the index bits
+    int index = addr_to_set(dmc, mb_start_addr);
     int result = (int) (uintptr_t) mb_start_addr;
-    int tag = result >> (MAIN_MEMORY_BLOCK_SIZE_LN + DIRECT_MAPPED_NUM_SETS_LN);
+    int tag = result >> MAIN_MEMORY_BLOCK_SIZE_LN;
     int mem_addr_tag = (int) (((uintptr_t) dmc->cache_set[index].mem_block->start_addr)
-                >> (MAIN_MEMORY_BLOCK_SIZE_LN + DIRECT_MAPPED_NUM_SETS_LN));
+                >> MAIN_MEMORY_BLOCK_SIZE_LN);
+
+    int is_hit = dmc->cache_set[index].is_valid == 1 && mem_addr_tag == tag;
+
+    // Non-temporal miss that bypasses the cache - write the word straight to main memory
+    if (!is_hit && dmc->non_temporal && dmc->nt_policy == NT_BYPASS)
+    {
+        mm_write_sector(dmc->mm, addr, &val, sizeof(val));
+        dmc->cs.w_misses++;
+        dmc->cs.w_queries++;
+        dmc->set_hist[index].misses++;
+        dmc->set_hist[index].queries++;
+        return;
+    }
 
     // Miss - Addr was not previously loaded into cache
-    if (!(dmc->cache_set[index].is_valid == 1 && mem_addr_tag == tag))
+    if (!is_hit)
     {
+        if (dmc->prof)
+            sp_switch(dmc->prof, SP_FILL);
+        if (dmc->cache_set[index].is_valid == 1)
+        {
+            dmc->set_hist[index].evictions++;
+            if (dmc->hot)
+                hot_evict(dmc->hot, dmc->cache_set[index].mem_block->start_addr, mb_start_addr);
+        }
+
         // Write memory block to main memory if valid and dirty
         if (dmc->cache_set[index].is_valid == 1 && dmc->cache_set[index].is_dirty == 1)
             mm_write(dmc->mm, dmc->cache_set[index].mem_block->start_addr, dmc->cache_set[index].mem_block);
@@ -76,8 +118,12 @@ void dmc_store_word(direct_mapped_cache* dmc, void* addr, unsigned int val)
         dmc->cache_set[index].is_dirty = 0;
 
         dmc->cs.w_misses++;
+        dmc->set_hist[index].misses++;
     }
 
+    if (dmc->prof)
+        sp_switch(dmc->prof, SP_UPDATE);
+
     // Extract required word care about
     unsigned int* mb_addr = dmc->cache_set[index].mem_block->data + addr_offt;
     *mb_addr = val;
@@ -85,6 +131,7 @@ void dmc_store_word(direct_mapped_cache* dmc, void* addr, unsigned int val)
 
     // Update statistics
     dmc->cs.w_queries++;
+    dmc->set_hist[index].queries++;
 }
 
 /**
@@ -101,15 +148,39 @@ unsigned int dmc_load_word(direct_mapped_cache* dmc, void* addr)
     size_t addr_offt = (size_t) (addr - MAIN_MEMORY_START_ADDR) % MAIN_MEMORY_BLOCK_SIZE;
     void* mb_start_addr = addr - addr_offt;
 
-    int index = addr_to_set(mb_start_addr);
+    // Tags are full block numbers, since hashed indexing does not keep the index bits
+    int index = addr_to_set(dmc, mb_start_addr);
     int result = (int) (uintptr_t) mb_start_addr;
-    int tag = result >> (MAIN_MEMORY_BLOCK_SIZE_LN + DIRECT_MAPPED_NUM_SETS_LN);
+    int tag = result >> MAIN_MEMORY_BLOCK_SIZE_LN;
     int mem_addr_tag = (int) (((uintptr_t) dmc->cache_set[index].mem_block->start_addr)
-                >> (MAIN_MEMORY_BLOCK_SIZE_LN + DIRECT_MAPPED_NUM_SETS_LN));
+                >> MAIN_MEMORY_BLOCK_SIZE_LN);
+
+    int is_hit = dmc->cache_set[index].is_valid == 1 && mem_addr_tag == tag;
+
+    // Non-temporal miss that bypasses the cache - read the word straight from main memory
+    if (!is_hit && dmc->non_temporal && dmc->nt_policy == NT_BYPASS)
+    {
+        unsigned int val;
+        mm_read_sector(dmc->mm, addr, &val, sizeof(val));
+        dmc->cs.r_misses++;
+        dmc->cs.r_queries++;
+        dmc->set_hist[index].misses++;
+        dmc->set_hist[index].queries++;
+        return val;
+    }
 
     // Miss - Addr was not previously loaded into cache
-    if (!(dmc->cache_set[index].is_valid == 1 && mem_addr_tag == tag))
+    if (!is_hit)
     {
+        if (dmc->prof)
+            sp_switch(dmc->prof, SP_FILL);
+        if (dmc->cache_set[index].is_valid == 1)
+        {
+            dmc->set_hist[index].evictions++;
+            if (dmc->hot)
+                hot_evict(dmc->hot, dmc->cache_set[index].mem_block->start_addr, mb_start_addr);
+        }
+
         // Write memory block to main memory if valid and dirty
         if (dmc->cache_set[index].is_valid == 1 && dmc->cache_set[index].is_dirty == 1)
             mm_write(dmc->mm, dmc->cache_set[index].mem_block->start_addr, dmc->cache_set[index].mem_block);
@@ -122,17 +193,60 @@ unsigned int dmc_load_word(direct_mapped_cache* dmc, void* addr)
         dmc->cache_set[index].is_valid = 1;
         dmc->cache_set[index].is_dirty = 0;
         dmc->cs.r_misses++;
+        dmc->set_hist[index].misses++;
     }
 
+    if (dmc->prof)
+        sp_switch(dmc->prof, SP_UPDATE);
+
     // Extract required word care about
     unsigned int* mb_addr = dmc->cache_set[index].mem_block->data + addr_offt;
 
     // Update statistics
     dmc->cs.r_queries++;
+    dmc->set_hist[index].queries++;
 
     return *mb_addr;
 }
 
+/**
+ * Clean (write back if dirty) and/or invalidate the line holding addr, if cached
+ * @param dmc: pointer to cache
+ * @param op: MAINT_CLEAN, MAINT_INVALIDATE or MAINT_CLEAN_INVALIDATE
+ * @param addr: any address in the block
+ */
+void dmc_maintain(direct_mapped_cache* dmc, int op, void* addr)
+{
+    size_t addr_offt = (size_t) (addr - MAIN_MEMORY_START_ADDR) % MAIN_MEMORY_BLOCK_SIZE;
+    void* mb_start_addr = addr - addr_offt;
+    int index = addr_to_set(dmc, mb_start_addr);
+    direct_map_set* line = &dmc->cache_set[index];
+
+    if (line->is_valid != 1 || line->mem_block->start_addr != mb_start_addr)
+        return;
+    if ((op & MAINT_CLEAN) && line->is_dirty == 1)
+    {
+        mm_write(dmc->mm, line->mem_block->start_addr, line->mem_block);
+        line->is_dirty = 0;
+    }
+    if (op & MAINT_INVALIDATE)
+    {
+        line->is_valid = 0;
+        line->is_dirty = 0;
+    }
+}
+
+/**
+ * Write back every dirty line and invalidate the whole cache
+ * @param dmc: pointer to cache
+ */
+void dmc_flush(direct_mapped_cache* dmc)
+{
+    for (int i = 0; i < DIRECT_MAPPED_NUM_SETS; i++)
+        if (dmc->cache_set[i].is_valid == 1)
+            dmc_maintain(dmc, MAINT_CLEAN_INVALIDATE, dmc->cache_set[i].mem_block->start_addr);
+}
+
 /**
  * Free memory allocated to cache
  * @param dmc: pointer to cache
@@ -142,6 +256,7 @@ void dmc_free(direct_mapped_cache* dmc)
     for (int i = 0; i < DIRECT_MAPPED_NUM_SETS; i++)
         mb_free(dmc->cache_set[i].mem_block);
 
+    free(dmc->set_hist);
     free(dmc->cache_set);
     free(dmc);
 }
@@ -3,6 +3,10 @@
 
 #include "main_memory.h"
 #include "cache_stats.h"
+#include "set_index.h"
+#include "selfprof.h"
+#include "hotness.h"
+#include "cache_ops.h"
 
 #define DIRECT_MAPPED_NUM_SETS 16
 #define DIRECT_MAPPED_NUM_SETS_LN 4
@@ -19,6 +23,12 @@ typedef struct direct_mapped_cache
     main_memory* mm;
     cache_stats cs;
     direct_map_set* cache_set;
+    int index_fn;
+    set_stats* set_hist;
+    selfprof* prof;
+    hotness* hot;
+    int non_temporal;
+    int nt_policy;
 } direct_mapped_cache;
 
 direct_mapped_cache* dmc_init(main_memory* mm);
@@ -27,6 +37,12 @@ void dmc_store_word(direct_mapped_cache* dmc, void* addr, unsigned int val);
 
 unsigned int dmc_load_word(direct_mapped_cache* dmc, void* addr);
 
+void dmc_maintain(direct_mapped_cache* dmc, int op, void* addr);
+
+void dmc_flush(direct_mapped_cache* dmc);
+
+int dmc_set_index(direct_mapped_cache* dmc, void* addr);
+
 void dmc_free(direct_mapped_cache* dmc);
 
 #endif
@@ -0,0 +1,269 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "main_memory.h"
+#include "dram.h"
+
+/**
+ * Allocate DRAM model with all banks precharged
+ * @param policy: DRAM_POLICY_OPEN or DRAM_POLICY_CLOSED
+ * @param mapping: DRAM_MAP_ROW or DRAM_MAP_BLOCK
+ * @return initialized DRAM model
+ */
+dram* dram_init(int policy, int mapping)
+{
+    dram* result = malloc(sizeof(dram));
+    memset(result, 0, sizeof(dram));
+    result->policy = policy;
+    result->mapping = mapping;
+    result->next_refresh = DRAM_T_REFI;
+    return result;
+}
+
+/**
+ * Split a block address into channel, rank, bank and row
+ * @param d: pointer to DRAM model
+ * @param req: request whose addr is decoded in place
+ */
+static void map_address(dram* d, dram_request* req)
+{
+    uint32_t block = req->addr >> MAIN_MEMORY_BLOCK_SIZE_LN;
+    int column_ln = DRAM_ROW_SIZE_LN - MAIN_MEMORY_BLOCK_SIZE_LN;
+
+    if (d->mapping == DRAM_MAP_ROW)
+    {
+        block >>= column_ln;
+        req->channel = block & (DRAM_NUM_CHANNELS - 1);
+        block >>= DRAM_NUM_CHANNELS_LN;
+        req->bank = block & (DRAM_NUM_BANKS - 1);
+        block >>= DRAM_NUM_BANKS_LN;
+        req->rank = block & (DRAM_NUM_RANKS - 1);
+        block >>= DRAM_NUM_RANKS_LN;
+        req->row = block;
+    }
+    else
+    {
+        req->channel = block & (DRAM_NUM_CHANNELS - 1);
+        block >>= DRAM_NUM_CHANNELS_LN;
+        req->bank = block & (DRAM_NUM_BANKS - 1);
+        block >>= DRAM_NUM_BANKS_LN;
+        req->rank = block & (DRAM_NUM_RANKS - 1);
+        block >>= DRAM_NUM_RANKS_LN;
+        req->row = block >> column_ln;
+    }
+}
+
+/**
+ * Earliest cycle at which a queued request can start
+ * @param d: pointer to DRAM model
+ * @param req: queued request
+ * @return start cycle
+ */
+static unsigned long start_time(dram* d, dram_request* req)
+{
+    unsigned long ready = d->banks[req->channel][req->rank][req->bank].ready;
+    return ready > req->arrival ? ready : req->arrival;
+}
+
+/**
+ * Close all rows and stall every bank for refreshes due before cycle t
+ * @param d: pointer to DRAM model
+ * @param t: cycle a command is about to be issued at
+ */
+static void refresh_until(dram* d, unsigned long t)
+{
+    while (d->next_refresh <= t)
+    {
+        for (int c = 0; c < DRAM_NUM_CHANNELS; c++)
+            for (int r = 0; r < DRAM_NUM_RANKS; r++)
+                for (int b = 0; b < DRAM_NUM_BANKS; b++)
+                {
+                    dram_bank* bank = &d->banks[c][r][b];
+                    bank->row_open = 0;
+                    if (bank->ready < d->next_refresh + DRAM_T_RFC)
+                        bank->ready = d->next_refresh + DRAM_T_RFC;
+                }
+        d->refreshes++;
+        d->next_refresh += DRAM_T_REFI;
+    }
+}
+
+/**
+ * Issue queue entry i to its bank and remove it from the queue
+ * @param d: pointer to DRAM model
+ * @param i: index of request in queue
+ */
+static void service(dram* d, int i)
+{
+    dram_request req = d->queue[i];
+    if (i != 0)
+        d->reordered++;
+    memmove(d->queue + i, d->queue + i + 1, (d->queue_len - i - 1) * sizeof(dram_request));
+    d->queue_len--;
+
+    refresh_until(d, start_time(d, &req));
+    dram_bank* bank = &d->banks[req.channel][req.rank][req.bank];
+    unsigned long start = start_time(d, &req);
+
+    unsigned long latency;
+    if (bank->row_open && bank->open_row == req.row)
+    {
+        d->row_hits++;
+        latency = DRAM_T_CAS;
+    }
+    else if (bank->row_open)
+    {
+        d->row_conflicts++;
+        latency = DRAM_T_RP + DRAM_T_RCD + DRAM_T_CAS;
+    }
+    else
+    {
+        d->row_empty++;
+        latency = DRAM_T_RCD + DRAM_T_CAS;
+    }
+
+    // Data bursts of one channel are serialized on its bus
+    unsigned long done = start + latency;
+    if (done < d->bus_ready[req.channel])
+        done = d->bus_ready[req.channel];
+    done += DRAM_T_BURST;
+    d->bus_ready[req.channel] = done;
+
+    if (d->policy == DRAM_POLICY_OPEN)
+    {
+        bank->row_open = 1;
+        bank->open_row = req.row;
+        bank->ready = start + latency;
+    }
+    else
+    {
+        // Auto-precharge once the burst completes
+        bank->row_open = 0;
+        bank->ready = done + DRAM_T_RP;
+    }
+
+    if (req.is_write)
+    {
+        d->writes++;
+        d->write_latency += done - req.arrival;
+    }
+    else
+    {
+        d->reads++;
+        d->read_latency += done - req.arrival;
+    }
+    if (done > d->finish)
+        d->finish = done;
+}
+
+/**
+ * FR-FCFS: among requests that can start earliest, prefer row hits, then the oldest
+ * @param d: pointer to DRAM model
+ * @param until: only issue requests that can start at or before this cycle
+ * @return 1 if a request was issued, 0 otherwise
+ */
+static int schedule_one(dram* d, unsigned long until)
+{
+    if (d->queue_len == 0)
+        return 0;
+
+    unsigned long earliest = start_time(d, &d->queue[0]);
+    for (int i = 1; i < d->queue_len; i++)
+        if (start_time(d, &d->queue[i]) < earliest)
+            earliest = start_time(d, &d->queue[i]);
+    if (earliest > until)
+        return 0;
+
+    int pick = -1;
+    for (int i = 0; i < d->queue_len && pick == -1; i++)
+    {
+        dram_request* req = &d->queue[i];
+        dram_bank* bank = &d->banks[req->channel][req->rank][req->bank];
+        if (start_time(d, req) <= earliest && bank->row_open && bank->open_row == req->row)
+            pick = i;
+    }
+    for (int i = 0; i < d->queue_len && pick == -1; i++)
+        if (start_time(d, &d->queue[i]) <= earliest)
+            pick = i;
+
+    service(d, pick);
+    return 1;
+}
+
+/**
+ * Queue a block read or write issued by main memory at the current cycle
+ * @param d: pointer to DRAM model
+ * @param addr: block start address
+ * @param is_write: 1 for write backs, 0 for fills
+ */
+void dram_enqueue(dram* d, void* addr, int is_write)
+{
+    // A full queue forces the scheduler to issue regardless of the cycle
+    if (d->queue_len == DRAM_QUEUE_DEPTH)
+        schedule_one(d, (unsigned long) -1);
+
+    dram_request* req = &d->queue[d->queue_len++];
+    req->addr = (uint32_t) (uintptr_t) addr;
+    req->is_write = is_write;
+    req->arrival = d->clock;
+    map_address(d, req);
+}
+
+/**
+ * Advance the controller clock, issuing every request that can start meanwhile
+ * @param d: pointer to DRAM model
+ * @param cycles: number of cycles elapsed
+ */
+void dram_tick(dram* d, unsigned long cycles)
+{
+    d->clock += cycles;
+    while (schedule_one(d, d->clock))
+        ;
+}
+
+/**
+ * Issue all queued requests
+ * @param d: pointer to DRAM model
+ */
+void dram_drain(dram* d)
+{
+    while (schedule_one(d, (unsigned long) -1))
+        ;
+}
+
+/**
+ * Print row buffer and latency statistics (drains the queue first)
+ * @param d: pointer to DRAM model
+ */
+void dram_print(dram* d)
+{
+    dram_drain(d);
+    unsigned int total = d->reads + d->writes;
+    double hit_rate = total ? (double) d->row_hits / total * 100 : 0;
+
+    printf("DRAM Policy:\t\t%s-page, %s-interleaved\n",
+           d->policy == DRAM_POLICY_OPEN ? "open" : "closed",
+           d->mapping == DRAM_MAP_ROW ? "row" : "block");
+    printf("DRAM Reads/Writes:\t%u/%u\n", d->reads, d->writes);
+    printf("Row Hits:\t\t%u (%.0lf%%)\n", d->row_hits, hit_rate);
+    printf("Row Empty:\t\t%u\n", d->row_empty);
+    printf("Row Conflicts:\t\t%u\n", d->row_conflicts);
+    printf("Refreshes:\t\t%u\n", d->refreshes);
+    printf("Reordered Requests:\t%u\n", d->reordered);
+    printf("Avg Read Latency:\t%.1lf cycles\n",
+           d->reads ? (double) d->read_latency / d->reads : 0);
+    printf("Avg Write Latency:\t%.1lf cycles\n",
+           d->writes ? (double) d->write_latency / d->writes : 0);
+    printf("DRAM Finish Cycle:\t%lu\n", d->finish);
+    printf("*******************************************\n");
+}
+
+/**
+ * Free memory allocated to DRAM model
+ * @param d: pointer to DRAM model
+ */
+void dram_free(dram* d)
+{
+    free(d);
+}
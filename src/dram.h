@@ -0,0 +1,83 @@
+#ifndef DRAM_H
+#define DRAM_H
+
+#include <stdint.h>
+
+#define DRAM_NUM_CHANNELS 2
+#define DRAM_NUM_CHANNELS_LN 1
+#define DRAM_NUM_RANKS 2
+#define DRAM_NUM_RANKS_LN 1
+#define DRAM_NUM_BANKS 8
+#define DRAM_NUM_BANKS_LN 3
+#define DRAM_ROW_SIZE_LN 10
+#define DRAM_QUEUE_DEPTH 16
+
+// Timings in memory controller cycles
+#define DRAM_T_CAS 14
+#define DRAM_T_RCD 14
+#define DRAM_T_RP 14
+#define DRAM_T_BURST 4
+#define DRAM_T_REFI 7800
+#define DRAM_T_RFC 350
+
+#define DRAM_POLICY_OPEN 0
+#define DRAM_POLICY_CLOSED 1
+
+// Address mappings, most significant field first
+#define DRAM_MAP_ROW 0    // row:rank:bank:channel:column - blocks of a row are contiguous
+#define DRAM_MAP_BLOCK 1  // row:column:rank:bank:channel - consecutive blocks interleave
+
+typedef struct dram_request
+{
+    uint32_t addr;
+    int is_write;
+    unsigned long arrival;
+    int channel;
+    int rank;
+    int bank;
+    uint32_t row;
+} dram_request;
+
+typedef struct dram_bank
+{
+    int row_open;
+    uint32_t open_row;
+    unsigned long ready;
+} dram_bank;
+
+typedef struct dram
+{
+    int policy;
+    int mapping;
+    unsigned long clock;
+    unsigned long next_refresh;
+    dram_bank banks[DRAM_NUM_CHANNELS][DRAM_NUM_RANKS][DRAM_NUM_BANKS];
+    unsigned long bus_ready[DRAM_NUM_CHANNELS];
+    dram_request queue[DRAM_QUEUE_DEPTH];
+    int queue_len;
+
+    unsigned int reads;
+    unsigned int writes;
+    unsigned int row_hits;
+    unsigned int row_empty;
+    unsigned int row_conflicts;
+    unsigned int refreshes;
+    unsigned int reordered;
+    unsigned long read_latency;
+    unsigned long write_latency;
+    unsigned long finish;
+} dram;
+
+dram* dram_init(int policy, int mapping);
+
+void dram_enqueue(dram* d, void* addr, int is_write);
+
+void dram_tick(dram* d, unsigned long cycles);
+
+void dram_drain(dram* d);
+
+void dram_print(dram* d);
+
+void dram_free(dram* d);
+
+#endif
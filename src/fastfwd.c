@@ -0,0 +1,379 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "fastfwd.h"
+
+#define FNV_OFFSET 0xcbf29ce484222325ull
+#define FNV_PRIME 0x100000001b3ull
+
+// Earlier records with a colliding hash bucket examined per simulated record
+#define FASTFWD_MAX_CANDIDATES 64
+
+/**
+ * Fold one word into an FNV-1a hash
+ */
+static uint64_t mix(uint64_t h, uint64_t v)
+{
+    for (int i = 0; i < 8; i++, v >>= 8)
+        h = (h ^ (v & 0xff)) * FNV_PRIME;
+    return h;
+}
+
+static uint64_t mix_usage(uint64_t h, float usage)
+{
+    uint32_t bits;
+    memcpy(&bits, &usage, sizeof(bits));
+    return mix(h, bits);
+}
+
+/**
+ * Hash everything that decides the outcome of future accesses: tags, valid
+ * and dirty bits, raw LRU usage counts and fill counters. Line data is left
+ * out since it never affects hits, misses or write backs
+ * @param c: pointer to cache
+ * @return state hash
+ */
+static uint64_t state_hash(cache* c)
+{
+    uint64_t h = FNV_OFFSET;
+    if (c->mode == MODE_DMC)
+    {
+        for (int i = 0; i < DIRECT_MAPPED_NUM_SETS; i++)
+        {
+            direct_map_set* line = &c->dmc->cache_set[i];
+            h = mix(h, line->is_valid | line->is_dirty << 1);
+            if (line->is_valid)
+                h = mix(h, (uintptr_t) line->mem_block->start_addr);
+        }
+    }
+    else if (c->mode == MODE_FAC)
+    {
+        h = mix(h, c->fac->num_sets);
+        for (int i = 0; i < c->fac->num_sets; i++)
+        {
+            fully_assoc_set* line = &c->fac->cache_set[i];
+            h = mix(h, line->is_valid | line->is_dirty << 1);
+            if (line->is_valid)
+                h = mix(h, (uintptr_t) line->mem_block->start_addr);
+            h = mix_usage(h, c->fac->usage[i]);
+        }
+    }
+    else if (c->mode == MODE_SAC)
+    {
+        for (int i = 0; i < SET_ASSOCIATIVE_NUM_SETS; i++)
+        {
+            sac_map_set* set = &c->sac->cache_set[i];
+            h = mix(h, set->num_ways);
+            for (int j = 0; j < SET_ASSOCIATIVE_NUM_WAYS; j++)
+            {
+                sac_map_way* way = &set->ways[j];
+                h = mix(h, way->is_valid | way->is_dirty << 1);
+                if (!way->is_valid)
+                    continue;
+                h = mix(h, (uintptr_t) way->mem_block->start_addr);
+                h = mix(h, way->valid_mask | (uint64_t) way->dirty_mask << 32);
+                h = mix_usage(h, set->usage[j]);
+            }
+        }
+    }
+    return h;
+}
+
+/**
+ * Append the fields of a cache_stats to the counter list
+ */
+static int add_stats(unsigned int** counters, int n, cache_stats* cs)
+{
+    counters[n++] = &cs->w_queries;
+    counters[n++] = &cs->r_queries;
+    counters[n++] = &cs->w_misses;
+    counters[n++] = &cs->r_misses;
+    return n;
+}
+
+/**
+ * Allocate fast-forward detector
+ * A period is found when the state hash after a record equals the hash after
+ * an earlier record at most window records back. Later records are then only
+ * compared against that period; each full repetition is skipped and its
+ * statistics added as a multiple of the period's delta
+ * @param c: pointer to cache
+ * @param mm: main memory, whose traffic counters also repeat
+ * @param window: longest period in records
+ * @return initialized detector
+ */
+fast_forward* ff_init(cache* c, main_memory* mm, unsigned long window)
+{
+    fast_forward* result = calloc(1, sizeof(fast_forward));
+    result->c = c;
+    result->window = window;
+
+    set_stats* hist = cache_set_hist(c);
+    int num_sets = hist ? cache_num_sets(c) : 0;
+    result->counters = malloc((16 + 4 * SET_ASSOCIATIVE_MAX_TENANTS + 3 * num_sets)
+                              * sizeof(unsigned int*));
+    int n = add_stats(result->counters, 0, cache_get_stats(c));
+    result->counters[n++] = &mm->w_queries;
+    result->counters[n++] = &mm->r_queries;
+    result->counters[n++] = &mm->w_bytes;
+    result->counters[n++] = &mm->r_bytes;
+    result->counters[n++] = &c->ops.nt_loads;
+    result->counters[n++] = &c->ops.nt_stores;
+    result->counters[n++] = &c->ops.cleans;
+    result->counters[n++] = &c->ops.invalidates;
+    result->counters[n++] = &c->ops.clean_invalidates;
+    result->counters[n++] = &c->ops.flushes;
+    result->counters[n++] = &c->ops.maint_w_queries;
+    result->counters[n++] = &c->ops.maint_w_bytes;
+    if (c->mode == MODE_SAC)
+        for (int t = 0; t < SET_ASSOCIATIVE_MAX_TENANTS; t++)
+            n = add_stats(result->counters, n, &c->sac->tenant_cs[t]);
+    for (int i = 0; i < num_sets; i++)
+    {
+        result->counters[n++] = &hist[i].queries;
+        result->counters[n++] = &hist[i].misses;
+        result->counters[n++] = &hist[i].evictions;
+    }
+    result->num_counters = n;
+    result->delta = malloc(n * sizeof(unsigned int));
+
+    // A period is confirmed against the one before it, so keep two windows
+    result->ring_size = 2 * window + 1;
+    result->ring = calloc(result->ring_size, sizeof(ff_entry));
+    result->pending = malloc(window * sizeof(ff_record));
+    result->snapshots = malloc(result->ring_size * n * sizeof(unsigned int));
+
+    // Direct-mapped table from state hash to the latest record index + 1
+    uint64_t table_size = 1;
+    while (table_size < result->ring_size)
+        table_size <<= 1;
+    result->table = calloc(table_size, sizeof(unsigned long));
+    result->table_mask = table_size - 1;
+    return result;
+}
+
+static ff_record make_record(char RW, void* addr, unsigned int val, int tenant)
+{
+    ff_record result = { RW, addr, val, tenant };
+    return result;
+}
+
+/**
+ * Check whether two records have the same effect on hits, misses and write
+ * backs: stored values never matter, and word offsets only matter to
+ * sectored lines
+ * @param ff: pointer to detector
+ * @param a, b: records to compare
+ * @return 1 if equivalent
+ */
+static int same_record(fast_forward* ff, ff_record* a, ff_record* b)
+{
+    uintptr_t mask = ~(uintptr_t) 0;
+    if (!(ff->c->mode == MODE_SAC && ff->c->sac->sectored))
+        mask <<= MAIN_MEMORY_BLOCK_SIZE_LN;
+    return a->RW == b->RW && a->tenant == b->tenant
+           && ((uintptr_t) a->addr & mask) == ((uintptr_t) b->addr & mask);
+}
+
+/**
+ * Check whether a query count in (from, from + count] is a multiple of
+ * NEARING_OVERFLOW, counting in unsigned int like the caches do
+ */
+static int crosses_normalization(unsigned int from, unsigned long count)
+{
+    uint64_t last = (uint64_t) from + count;
+
+    // Wrapping past UINT_MAX reaches 0, which is a multiple as well
+    if (count >= NEARING_OVERFLOW || last > UINT32_MAX)
+        return 1;
+    return last / NEARING_OVERFLOW != from / NEARING_OVERFLOW;
+}
+
+/**
+ * Simulate a record that skip mode absorbed but could not skip
+ */
+static void replay(fast_forward* ff, ff_record* rec)
+{
+    if (ff->c->mode == MODE_SAC)
+        ff->c->sac->tenant = rec->tenant;
+    cache_access(ff->c, rec->RW, rec->addr, rec->val);
+    ff_record_access(ff, rec->RW, rec->addr, rec->val, rec->tenant);
+}
+
+/**
+ * Leave skip mode: add the skipped periods' statistics, then simulate the
+ * records of the current, partially matched period
+ * @param ff: pointer to detector
+ */
+static void stop_skipping(fast_forward* ff)
+{
+    for (int k = 0; k < ff->num_counters; k++)
+        *ff->counters[k] += ff->periods * ff->delta[k];
+    if (ff->periods > 0)
+    {
+        ff->fast_forwards++;
+        ff->skipped_periods += ff->periods;
+        ff->skipped_records += ff->periods * ff->period;
+        if (ff->period > ff->longest_period)
+            ff->longest_period = ff->period;
+    }
+
+    // Snapshots taken before the jump in the counters cannot start a period
+    ff->skipping = 0;
+    ff->base = ff->next;
+
+    ff->replaying = 1;
+    for (unsigned long o = 0; o < ff->offset; o++)
+        replay(ff, &ff->pending[o]);
+    ff->replaying = 0;
+}
+
+/**
+ * Offer the next trace record to skip mode
+ * @param ff: pointer to detector
+ * @param RW, addr, val, tenant: trace record
+ * @return 1 if the record was handled, 0 if the caller must simulate it
+ *         and then call ff_record_access
+ */
+int ff_skip(fast_forward* ff, char RW, void* addr, unsigned int val, int tenant)
+{
+    if (!ff->skipping)
+        return 0;
+
+    ff_record rec = make_record(RW, addr, val, tenant);
+    ff_entry* expected = &ff->ring[(ff->period_start + 1 + ff->offset) % ff->ring_size];
+    if (!same_record(ff, &rec, &expected->rec))
+    {
+        stop_skipping(ff);
+        return 0;
+    }
+
+    ff->pending[ff->offset] = rec;
+    if (++ff->offset < ff->period)
+        return 1;
+
+    // A whole period matched; skip it unless it would cross a usage normalization
+    cache_stats* cs = cache_get_stats(ff->c);
+    unsigned int queries = cs->w_queries + cs->r_queries
+                           + ff->periods * (ff->delta[0] + ff->delta[1]);
+    if (crosses_normalization(queries, ff->delta[0] + ff->delta[1]))
+    {
+        stop_skipping(ff);
+        return 1;
+    }
+    ff->periods++;
+    ff->offset = 0;
+    return 1;
+}
+
+/**
+ * Find the shortest period ending at a record: an earlier record at most
+ * window back with the same state hash, where the records since then also
+ * repeat the ones before it
+ * @param ff: pointer to detector
+ * @param entry: record that was just simulated
+ * @return index of the record starting the period, -1 if none
+ */
+static long find_period(fast_forward* ff, ff_entry* entry)
+{
+    unsigned long start = entry->prev;
+    for (int tries = 0; tries < FASTFWD_MAX_CANDIDATES && start-- > 0; tries++)
+    {
+        unsigned long period = entry->index - start;
+        ff_entry* candidate = &ff->ring[start % ff->ring_size];
+        if (period > ff->window || start < ff->base + period || candidate->index != start)
+            return -1;
+        if (candidate->hash == entry->hash)
+        {
+            unsigned long o = 0;
+            while (o < period
+                   && same_record(ff, &ff->ring[(entry->index - o) % ff->ring_size].rec,
+                                  &ff->ring[(start - o) % ff->ring_size].rec))
+                o++;
+            if (o == period)
+                return start;
+        }
+        start = candidate->prev;
+    }
+    return -1;
+}
+
+/**
+ * Record a simulated access and enter skip mode when the state repeats
+ * @param ff: pointer to detector
+ * @param RW, addr, val, tenant: trace record that was just simulated
+ */
+void ff_record_access(fast_forward* ff, char RW, void* addr, unsigned int val, int tenant)
+{
+    unsigned long index = ff->next++;
+    unsigned long slot = index % ff->ring_size;
+    ff_entry* entry = &ff->ring[slot];
+    entry->index = index;
+    entry->hash = state_hash(ff->c);
+    entry->rec = make_record(RW, addr, val, tenant);
+
+    unsigned int* snapshot = ff->snapshots + slot * ff->num_counters;
+    for (int k = 0; k < ff->num_counters; k++)
+        snapshot[k] = *ff->counters[k];
+
+    // Records sharing a table bucket form a chain, newest first
+    unsigned long* bucket = &ff->table[entry->hash & ff->table_mask];
+    entry->prev = *bucket;
+    *bucket = index + 1;
+    if (ff->replaying)
+        return;
+
+    long start = find_period(ff, entry);
+    if (start == -1)
+        return;
+
+    unsigned int* before = ff->snapshots + (start % ff->ring_size) * ff->num_counters;
+    for (int k = 0; k < ff->num_counters; k++)
+        ff->delta[k] = snapshot[k] - before[k];
+    ff->skipping = 1;
+    ff->period_start = start;
+    ff->period = index - start;
+    ff->offset = 0;
+    ff->periods = 0;
+}
+
+/**
+ * Settle skip mode at the end of the trace
+ * @param ff: pointer to detector
+ */
+void ff_finish(fast_forward* ff)
+{
+    if (ff->skipping)
+        stop_skipping(ff);
+}
+
+/**
+ * Print fast-forward statistics
+ * @param ff: pointer to detector
+ */
+void ff_print(fast_forward* ff)
+{
+    unsigned long total = ff->next + ff->skipped_records;
+    printf("Fast-Forwards:\t\t%u\n", ff->fast_forwards);
+    printf("Skipped Periods:\t%lu\n", ff->skipped_periods);
+    printf("Skipped Records:\t%lu (%.1lf%%)\n", ff->skipped_records,
+           total ? (double) ff->skipped_records / total * 100 : 0);
+    printf("Longest Period:\t\t%lu records\n", ff->longest_period);
+    printf("*******************************************\n");
+}
+
+/**
+ * Free memory allocated to detector
+ * @param ff: pointer to detector
+ */
+void ff_free(fast_forward* ff)
+{
+    free(ff->counters);
+    free(ff->delta);
+    free(ff->ring);
+    free(ff->pending);
+    free(ff->snapshots);
+    free(ff->table);
+    free(ff);
+}
@@ -0,0 +1,70 @@
+#ifndef FASTFWD_H
+#define FASTFWD_H
+
+#include <stdint.h>
+
+#include "cache.h"
+
+typedef struct ff_record
+{
+    char RW;
+    void* addr;
+    unsigned int val;
+    int tenant;
+} ff_record;
+
+typedef struct ff_entry
+{
+    unsigned long index;
+    unsigned long prev;
+    uint64_t hash;
+    ff_record rec;
+} ff_entry;
+
+typedef struct fast_forward
+{
+    cache* c;
+    unsigned long window;
+    unsigned long ring_size;
+
+    // Last 2 * window + 1 simulated records with the state hash and counters after each
+    ff_entry* ring;
+    unsigned int* snapshots;
+    unsigned long* table;
+    uint64_t table_mask;
+
+    // Every statistic that a skipped period adds to
+    unsigned int** counters;
+    unsigned int* delta;
+    int num_counters;
+
+    unsigned long next;
+    unsigned long base;
+    int replaying;
+
+    int skipping;
+    unsigned long period_start;
+    unsigned long period;
+    unsigned long offset;
+    unsigned long periods;
+    ff_record* pending;
+
+    unsigned int fast_forwards;
+    unsigned long skipped_periods;
+    unsigned long skipped_records;
+    unsigned long longest_period;
+} fast_forward;
+
+fast_forward* ff_init(cache* c, main_memory* mm, unsigned long window);
+
+int ff_skip(fast_forward* ff, char RW, void* addr, unsigned int val, int tenant);
+
+void ff_record_access(fast_forward* ff, char RW, void* addr, unsigned int val, int tenant);
+
+void ff_finish(fast_forward* ff);
+
+void ff_print(fast_forward* ff);
+
+void ff_free(fast_forward* ff);
+
+#endif
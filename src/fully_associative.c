@@ -5,8 +5,6 @@
 #include "memory_block.h"
 #include "fully_associative.h"
 
-#define NEARING_OVERFLOW 2147483640
-
 /**
  * Allocate memory and initialize cache
  * @param mm: main memory
@@ -18,6 +16,10 @@ fully_associative_cache* fac_init(main_memory* mm)
     result->mm = mm;
     result->cs = cs_init();
     result->num_sets = 0;
+    result->prof = NULL;
+    result->hot = NULL;
+    result->non_temporal = 0;
+    result->nt_policy = NT_INSERT_LRU;
     result->cache_set = malloc(FULLY_ASSOCIATIVE_NUM_WAYS * sizeof(fully_assoc_set));
     result->usage = malloc(FULLY_ASSOCIATIVE_NUM_WAYS * sizeof(int));
     for (int i = 0; i < FULLY_ASSOCIATIVE_NUM_WAYS; i++)
@@ -47,6 +49,11 @@ static int lru(fully_associative_cache* fac)
     if (fac->num_sets < FULLY_ASSOCIATIVE_NUM_WAYS)
         return fac->num_sets++;
 
+    // Reuse a line freed by an invalidation before evicting
+    for (int i = 0; i < FULLY_ASSOCIATIVE_NUM_WAYS; i++)
+        if (fac->cache_set[i].is_valid != 1)
+            return i;
+
     int max_index = 0;
     float max_value = fac->usage[0];
 
@@ -73,6 +80,20 @@ static void normalize_usage_count(fully_associative_cache* fac)
         fac->usage[i] /= 2;
 }
 
+/**
+ * Place a non-temporal fill at the LRU position, so it is the next line evicted
+ * @param fac: pointer to cache
+ * @param index: way that was filled
+ */
+static void insert_lru(fully_associative_cache* fac, int index)
+{
+    float max_value = 0;
+    for (int i = 0; i < fac->num_sets; i++)
+        if (i != index && fac->usage[i] > max_value)
+            max_value = fac->usage[i];
+    fac->usage[index] = max_value + 1;
+}
+
 /**
  * Find way number in case of hit
  * @param fac: pointer to cache
@@ -110,12 +131,29 @@ void fac_store_word(fully_associative_cache* fac, void* addr, unsigned int val)
     void* mb_start_addr = addr - addr_offt;
 
     int index = find_hit(fac, mb_start_addr);
+    int was_miss = index == -1;
+
+    // Non-temporal miss that bypasses the cache - write the word straight to main memory
+    if (was_miss && fac->non_temporal && fac->nt_policy == NT_BYPASS)
+    {
+        mm_write_sector(fac->mm, addr, &val, sizeof(val));
+        fac->cs.w_misses++;
+        fac->cs.w_queries++;
+        if ((fac->cs.w_queries + fac->cs.r_queries) % NEARING_OVERFLOW == 0)
+            normalize_usage_count(fac);
+        return;
+    }
 
     // Miss - Addr was not previously loaded into cache
     if (index == -1)
     {
+        if (fac->prof)
+            sp_switch(fac->prof, SP_FILL);
+
         // Get least recently used way
         index = lru(fac);
+        if (fac->hot && fac->cache_set[index].is_valid == 1)
+            hot_evict(fac->hot, fac->cache_set[index].mem_block->start_addr, mb_start_addr);
 
         // Write memory block to main memory if valid and dirty
         if (fac->cache_set[index].is_valid == 1 && fac->cache_set[index].is_dirty == 1)
@@ -132,15 +170,24 @@ void fac_store_word(fully_associative_cache* fac, void* addr, unsigned int val)
         fac->cs.w_misses++;
     }
 
+    if (fac->prof)
+        sp_switch(fac->prof, SP_UPDATE);
+
     // Extract required word care about
     unsigned int* mb_addr = fac->cache_set[index].mem_block->data + addr_offt;
     *mb_addr = val;
     fac->cache_set[index].is_dirty = 1;
 
-    fac->usage[index] = 0;
-    for (int i = 0; i < fac->num_sets; i++)
-        if (i != index)
-            fac->usage[i]++;
+    // Non-temporal hits keep their LRU position
+    if (!fac->non_temporal)
+    {
+        fac->usage[index] = 0;
+        for (int i = 0; i < fac->num_sets; i++)
+            if (i != index)
+                fac->usage[i]++;
+    }
+    else if (was_miss)
+        insert_lru(fac, index);
 
     // Update statistics
     fac->cs.w_queries++;
@@ -165,12 +212,30 @@ unsigned int fac_load_word(fully_associative_cache* fac, void* addr)
     void* mb_start_addr = addr - addr_offt;
 
     int index = find_hit(fac, mb_start_addr);
+    int was_miss = index == -1;
+
+    // Non-temporal miss that bypasses the cache - read the word straight from main memory
+    if (was_miss && fac->non_temporal && fac->nt_policy == NT_BYPASS)
+    {
+        unsigned int val;
+        mm_read_sector(fac->mm, addr, &val, sizeof(val));
+        fac->cs.r_misses++;
+        fac->cs.r_queries++;
+        if ((fac->cs.w_queries + fac->cs.r_queries) % NEARING_OVERFLOW == 0)
+            normalize_usage_count(fac);
+        return val;
+    }
 
     // Miss - Addr was not previously loaded into cache
     if (index == -1)
     {
+        if (fac->prof)
+            sp_switch(fac->prof, SP_FILL);
+
         // Get least recently used way
         index = lru(fac);
+        if (fac->hot && fac->cache_set[index].is_valid == 1)
+            hot_evict(fac->hot, fac->cache_set[index].mem_block->start_addr, mb_start_addr);
 
         // Write memory block to main memory if valid and dirty
         if (fac->cache_set[index].is_valid == 1 && fac->cache_set[index].is_dirty == 1)
@@ -187,13 +252,22 @@ unsigned int fac_load_word(fully_associative_cache* fac, void* addr)
         fac->cs.r_misses++;
     }
 
+    if (fac->prof)
+        sp_switch(fac->prof, SP_UPDATE);
+
     // Extract required word care about
     unsigned int* mb_addr = fac->cache_set[index].mem_block->data + addr_offt;
 
-    fac->usage[index] = 0;
-    for (int i = 0; i < fac->num_sets; i++)
-        if (i != index)
-            fac->usage[i]++;
+    // Non-temporal hits keep their LRU position
+    if (!fac->non_temporal)
+    {
+        fac->usage[index] = 0;
+        for (int i = 0; i < fac->num_sets; i++)
+            if (i != index)
+                fac->usage[i]++;
+    }
+    else if (was_miss)
+        insert_lru(fac, index);
 
     // Update statistics
     fac->cs.r_queries++;
@@ -205,6 +279,49 @@ unsigned int fac_load_word(fully_associative_cache* fac, void* addr)
     return *mb_addr;
 }
 
+/**
+ * Clean (write back if dirty) and/or invalidate a line
+ */
+static void maintain_line(fully_associative_cache* fac, int index, int op)
+{
+    fully_assoc_set* line = &fac->cache_set[index];
+    if ((op & MAINT_CLEAN) && line->is_dirty == 1)
+    {
+        mm_write(fac->mm, line->mem_block->start_addr, line->mem_block);
+        line->is_dirty = 0;
+    }
+    if (op & MAINT_INVALIDATE)
+    {
+        line->is_valid = 0;
+        line->is_dirty = 0;
+    }
+}
+
+/**
+ * Clean and/or invalidate the line holding addr, if cached
+ * @param fac: pointer to cache
+ * @param op: MAINT_CLEAN, MAINT_INVALIDATE or MAINT_CLEAN_INVALIDATE
+ * @param addr: any address in the block
+ */
+void fac_maintain(fully_associative_cache* fac, int op, void* addr)
+{
+    size_t addr_offt = (size_t) (addr - MAIN_MEMORY_START_ADDR) % MAIN_MEMORY_BLOCK_SIZE;
+    int index = find_hit(fac, addr - addr_offt);
+    if (index != -1)
+        maintain_line(fac, index, op);
+}
+
+/**
+ * Write back every dirty line and invalidate the whole cache
+ * @param fac: pointer to cache
+ */
+void fac_flush(fully_associative_cache* fac)
+{
+    for (int i = 0; i < fac->num_sets; i++)
+        if (fac->cache_set[i].is_valid == 1)
+            maintain_line(fac, i, MAINT_CLEAN_INVALIDATE);
+}
+
 /**
  * Free memory allocated to cache
  * @param fac: pointer to cache
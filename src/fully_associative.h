@@ -3,6 +3,9 @@
 
 #include "main_memory.h"
 #include "cache_stats.h"
+#include "selfprof.h"
+#include "hotness.h"
+#include "cache_ops.h"
 
 #define FULLY_ASSOCIATIVE_NUM_WAYS 16
 #define FULLY_ASSOCIATIVE_NUM_WAYS_LN 4
@@ -21,6 +24,10 @@ typedef struct fully_associative_cache
     int num_sets;
     fully_assoc_set* cache_set;
     float* usage;
+    selfprof* prof;
+    hotness* hot;
+    int non_temporal;
+    int nt_policy;
 } fully_associative_cache;
 
 fully_associative_cache* fac_init(main_memory* mm);
@@ -29,6 +36,10 @@ void fac_store_word(fully_associative_cache* fac, void* addr, unsigned int val);
 
 unsigned int fac_load_word(fully_associative_cache* fac, void* addr);
 
+void fac_maintain(fully_associative_cache* fac, int op, void* addr);
+
+void fac_flush(fully_associative_cache* fac);
+
 void fac_free(fully_associative_cache* fac);
 
 #endif
@@ -0,0 +1,250 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "hotness.h"
+#include "main_memory.h"
+#include "sampling.h"
+
+static void table_init(hot_table* t, uint32_t slots, int pairs)
+{
+    t->pairs = pairs;
+    t->slots = calloc(slots, sizeof(hot_entry));
+    t->mask = slots - 1;
+    t->used = 0;
+}
+
+/**
+ * Find an entry with linear probing, inserting a zeroed one if missing. The
+ * table may grow, so an entry pointer is only valid until the next lookup.
+ * @param t: table
+ * @param key: block or region address with bit 0 set
+ * @param other: evictor, ignored unless t is a pair table
+ * @return entry
+ */
+static hot_entry* find(hot_table* t, uint32_t key, uint32_t other)
+{
+    if (t->used + 1 > (t->mask + 1) / 4 * 3)
+    {
+        hot_table old = *t;
+        table_init(t, (old.mask + 1) * 2, old.pairs);
+        for (uint32_t i = 0; i <= old.mask; i++)
+            if (old.slots[i].key != 0)
+                *find(t, old.slots[i].key, old.slots[i].other) = old.slots[i];
+        free(old.slots);
+    }
+
+    if (!t->pairs)
+        other = 0;
+    uint32_t i = sampling_hash(key ^ sampling_hash(other)) & t->mask;
+    while (t->slots[i].key != 0)
+    {
+        if (t->slots[i].key == key && (!t->pairs || t->slots[i].other == other))
+            return &t->slots[i];
+        i = (i + 1) & t->mask;
+    }
+    t->slots[i].key = key;
+    t->slots[i].other = other;
+    t->used++;
+    return &t->slots[i];
+}
+
+/**
+ * Allocate a hotness profiler
+ * Accesses, misses and evictions are kept per memory block and per region,
+ * and every eviction is charged to the pair of victim and evicting block; a
+ * miss on a block that was evicted since its last miss is a conflict miss of
+ * that pair
+ * @param region_size: bytes per region, a power of two of at least one block
+ * @return initialized profiler
+ */
+hotness* hot_init(int region_size)
+{
+    hotness* result = malloc(sizeof(hotness));
+    result->region_shift = 0;
+    while ((1 << result->region_shift) < region_size)
+        result->region_shift++;
+    table_init(&result->blocks, HOT_INITIAL_SLOTS, 0);
+    table_init(&result->regions, HOT_INITIAL_SLOTS, 0);
+    table_init(&result->pairs, HOT_INITIAL_SLOTS, 1);
+    return result;
+}
+
+static uint32_t block_key(void* addr)
+{
+    return ((uint32_t) (uintptr_t) addr & ~(uint32_t) (MAIN_MEMORY_BLOCK_SIZE - 1)) | 1;
+}
+
+static uint32_t region_key(hotness* hp, uint32_t key)
+{
+    return (key >> hp->region_shift << hp->region_shift) | 1;
+}
+
+/**
+ * Count a simulated access
+ * @param hp: pointer to profiler
+ * @param addr: address accessed
+ * @param was_miss: whether the access missed
+ */
+void hot_access(hotness* hp, void* addr, int was_miss)
+{
+    uint32_t key = block_key(addr);
+    hot_entry* block = find(&hp->blocks, key, 0);
+    block->counts[HOT_ACCESSES]++;
+    uint32_t evictor = 0;
+    if (was_miss)
+    {
+        block->counts[HOT_MISSES]++;
+        evictor = block->other;
+        block->other = 0;
+        if (evictor)
+            block->counts[HOT_CONFLICT_MISSES]++;
+    }
+
+    hot_entry* region = find(&hp->regions, region_key(hp, key), 0);
+    region->counts[HOT_ACCESSES]++;
+    region->counts[HOT_MISSES] += was_miss;
+    if (evictor)
+    {
+        region->counts[HOT_CONFLICT_MISSES]++;
+        find(&hp->pairs, key, evictor)->counts[HOT_PAIR_MISSES]++;
+    }
+}
+
+/**
+ * Count the eviction of a valid line by a fill
+ * @param hp: pointer to profiler
+ * @param victim: start address of the evicted block
+ * @param by: start address of the block being filled
+ */
+void hot_evict(hotness* hp, void* victim, void* by)
+{
+    uint32_t victim_key = block_key(victim);
+    uint32_t by_key = block_key(by);
+
+    hot_entry* block = find(&hp->blocks, victim_key, 0);
+    block->counts[HOT_EVICTIONS_SUFFERED]++;
+    block->other = by_key;
+    find(&hp->blocks, by_key, 0)->counts[HOT_EVICTIONS_CAUSED]++;
+
+    find(&hp->regions, region_key(hp, victim_key), 0)->counts[HOT_EVICTIONS_SUFFERED]++;
+    find(&hp->regions, region_key(hp, by_key), 0)->counts[HOT_EVICTIONS_CAUSED]++;
+    find(&hp->pairs, victim_key, by_key)->counts[HOT_PAIR_EVICTIONS]++;
+}
+
+/**
+ * Order entries by misses, then accesses or evictions, then address
+ */
+static int by_misses(const void* a, const void* b)
+{
+    const hot_entry* x = a;
+    const hot_entry* y = b;
+    if (x->counts[HOT_MISSES] != y->counts[HOT_MISSES])
+        return x->counts[HOT_MISSES] < y->counts[HOT_MISSES] ? 1 : -1;
+    if (x->counts[0] != y->counts[0])
+        return x->counts[0] < y->counts[0] ? 1 : -1;
+    if (x->key != y->key)
+        return x->key > y->key ? 1 : -1;
+    return x->other > y->other ? 1 : (x->other < y->other ? -1 : 0);
+}
+
+/**
+ * Copy the occupied entries of a table, sorted by by_misses
+ * @param t: table
+ * @return t->used entries, to be freed by the caller
+ */
+static hot_entry* sorted(hot_table* t)
+{
+    hot_entry* result = malloc((t->used + 1) * sizeof(hot_entry));
+    uint32_t n = 0;
+    for (uint32_t i = 0; i <= t->mask; i++)
+        if (t->slots[i].key != 0)
+            result[n++] = t->slots[i];
+    qsort(result, n, sizeof(hot_entry), by_misses);
+    return result;
+}
+
+static void print_entries(hot_table* t, int top)
+{
+    hot_entry* entries = sorted(t);
+    for (uint32_t i = 0; i < t->used && i < (uint32_t) top; i++)
+        printf("0x%x\t%u\t%u\t%u\t%u\t%u\n", entries[i].key - 1, entries[i].counts[HOT_ACCESSES],
+               entries[i].counts[HOT_MISSES], entries[i].counts[HOT_CONFLICT_MISSES],
+               entries[i].counts[HOT_EVICTIONS_CAUSED], entries[i].counts[HOT_EVICTIONS_SUFFERED]);
+    free(entries);
+}
+
+/**
+ * Print the blocks, regions and conflict pairs with the most misses
+ * @param hp: pointer to profiler
+ * @param top: rows per table
+ */
+void hot_print(hotness* hp, int top)
+{
+    printf("Hot Blocks:\t\t%u tracked\n", hp->blocks.used);
+    printf("Block\tAccess\tMisses\tConfl\tEvicts\tEvicted\n");
+    print_entries(&hp->blocks, top);
+    printf("Hot Regions:\t\t%u tracked, %d bytes\n", hp->regions.used, 1 << hp->region_shift);
+    printf("Region\tAccess\tMisses\tConfl\tEvicts\tEvicted\n");
+    print_entries(&hp->regions, top);
+
+    hot_entry* pairs = sorted(&hp->pairs);
+    printf("Conflict Pairs:\t\t%u tracked\n", hp->pairs.used);
+    printf("Victim\tEvictor\tEvicts\tMisses\n");
+    for (uint32_t i = 0; i < hp->pairs.used && i < (uint32_t) top; i++)
+        printf("0x%x\t0x%x\t%u\t%u\n", pairs[i].key - 1, pairs[i].other - 1,
+               pairs[i].counts[HOT_PAIR_EVICTIONS], pairs[i].counts[HOT_PAIR_MISSES]);
+    free(pairs);
+    printf("*******************************************\n");
+}
+
+/**
+ * Write misses as folded stacks (region;block;cause count) for flamegraph.pl;
+ * the cause is the evicting block, or no eviction for cold and bypass misses
+ * @param hp: pointer to profiler
+ * @param path: output file
+ */
+void hot_write_folded(hotness* hp, const char* path)
+{
+    FILE* file = fopen(path, "w");
+    if (file == NULL)
+    {
+        fprintf(stderr, "Error: Could not open %s.\n", path);
+        exit(3);
+    }
+
+    hot_entry* blocks = sorted(&hp->blocks);
+    for (uint32_t i = 0; i < hp->blocks.used; i++)
+    {
+        unsigned int other = blocks[i].counts[HOT_MISSES] - blocks[i].counts[HOT_CONFLICT_MISSES];
+        if (other > 0)
+            fprintf(file, "region 0x%x;block 0x%x;no eviction %u\n", region_key(hp, blocks[i].key) - 1,
+                    blocks[i].key - 1, other);
+    }
+    free(blocks);
+
+    hot_entry* pairs = sorted(&hp->pairs);
+    for (uint32_t i = 0; i < hp->pairs.used; i++)
+        if (pairs[i].counts[HOT_PAIR_MISSES] > 0)
+            fprintf(file, "region 0x%x;block 0x%x;evicted by 0x%x %u\n", region_key(hp, pairs[i].key) - 1,
+                    pairs[i].key - 1, pairs[i].other - 1, pairs[i].counts[HOT_PAIR_MISSES]);
+    free(pairs);
+
+    if (ferror(file) || fclose(file) != 0)
+    {
+        fprintf(stderr, "Error: Could not write %s.\n", path);
+        exit(3);
+    }
+}
+
+/**
+ * Free profiler
+ * @param hp: pointer to profiler
+ */
+void hot_free(hotness* hp)
+{
+    free(hp->blocks.slots);
+    free(hp->regions.slots);
+    free(hp->pairs.slots);
+    free(hp);
+}
@@ -0,0 +1,60 @@
+#ifndef HOTNESS_H
+#define HOTNESS_H
+
+#include <stdint.h>
+
+#define HOT_ACCESSES 0
+#define HOT_MISSES 1
+#define HOT_EVICTIONS_CAUSED 2
+#define HOT_EVICTIONS_SUFFERED 3
+#define HOT_CONFLICT_MISSES 4
+#define HOT_NUM_COUNTS 5
+
+// Conflict pairs count the victim's evictions by the evictor and its misses since
+#define HOT_PAIR_EVICTIONS 0
+#define HOT_PAIR_MISSES 1
+
+// Initial slots per table; tables double when three quarters full
+#define HOT_INITIAL_SLOTS 256
+
+// Default region size in bytes, a page
+#define HOT_DEFAULT_REGION 4096
+
+typedef struct hot_entry
+{
+    // Block or region address with bit 0 set, so 0 marks an empty slot
+    uint32_t key;
+    // Block entries: block that last evicted this one; pair entries: the evictor
+    uint32_t other;
+    unsigned int counts[HOT_NUM_COUNTS];
+} hot_entry;
+
+typedef struct hot_table
+{
+    hot_entry* slots;
+    uint32_t mask;
+    uint32_t used;
+    int pairs;
+} hot_table;
+
+typedef struct hotness
+{
+    int region_shift;
+    hot_table blocks;
+    hot_table regions;
+    hot_table pairs;
+} hotness;
+
+hotness* hot_init(int region_size);
+
+void hot_access(hotness* hp, void* addr, int was_miss);
+
+void hot_evict(hotness* hp, void* victim, void* by);
+
+void hot_print(hotness* hp, int top);
+
+void hot_write_folded(hotness* hp, const char* path);
+
+void hot_free(hotness* hp);
+
+#endif
@@ -0,0 +1,153 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "live_stats.h"
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Create the shared memory segment statistics are published to
+ * @param name: POSIX shared memory name, e.g. /cache-sim
+ * @param mode: cache mode being simulated
+ * @param trace: path of the trace being simulated
+ * @return publisher
+ */
+live_stats* live_open(const char* name, const char* mode, const char* trace)
+{
+    int fd = shm_open(name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd == -1 || ftruncate(fd, sizeof(live_stats_segment)) == -1)
+    {
+        fprintf(stderr, "Error: Could not create shared memory %s.\n", name);
+        exit(3);
+    }
+    live_stats_segment* seg = mmap(NULL, sizeof(live_stats_segment), PROT_READ | PROT_WRITE,
+                                   MAP_SHARED, fd, 0);
+    close(fd);
+    if (seg == MAP_FAILED)
+    {
+        fprintf(stderr, "Error: Could not map shared memory %s.\n", name);
+        exit(3);
+    }
+
+    struct stat st;
+    live_stats_data* data = &seg->data;
+    data->pid = getpid();
+    strncpy(data->mode, mode, sizeof(data->mode) - 1);
+    strncpy(data->trace, trace, sizeof(data->trace) - 1);
+    data->trace_size = stat(trace, &st) == 0 ? st.st_size : 0;
+    atomic_store(&seg->seq, 0);
+    seg->version = LIVE_STATS_VERSION;
+    seg->magic = LIVE_STATS_MAGIC;
+
+    live_stats* result = malloc(sizeof(live_stats));
+    result->name = strdup(name);
+    result->seg = seg;
+    result->start = now();
+    result->countdown = 0;
+    return result;
+}
+
+/**
+ * Publish current statistics with a seqlock write; only every
+ * LIVE_STATS_INTERVAL-th call does any work unless finished is set
+ * @param ls: publisher
+ * @param cs: cache statistics
+ * @param mm: main memory, for traffic counters
+ * @param offset: bytes of the trace consumed
+ * @param lines: trace lines consumed
+ * @param finished: 1 once the trace is done
+ */
+void live_publish(live_stats* ls, cache_stats* cs, main_memory* mm, uint64_t offset,
+                  uint64_t lines, int finished)
+{
+    if (ls->countdown-- > 0 && !finished)
+        return;
+    ls->countdown = LIVE_STATS_INTERVAL - 1;
+
+    live_stats_segment* seg = ls->seg;
+    uint64_t seq = atomic_load_explicit(&seg->seq, memory_order_relaxed);
+    atomic_store_explicit(&seg->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    seg->data.finished = finished;
+    seg->data.trace_offset = offset;
+    seg->data.lines = lines;
+    seg->data.elapsed = now() - ls->start;
+    seg->data.cs = *cs;
+    seg->data.mm_w_queries = mm->w_queries;
+    seg->data.mm_r_queries = mm->r_queries;
+    seg->data.mm_w_bytes = mm->w_bytes;
+    seg->data.mm_r_bytes = mm->r_bytes;
+
+    atomic_store_explicit(&seg->seq, seq + 2, memory_order_release);
+}
+
+/**
+ * Map a segment published by a running simulation, read only
+ * @param name: POSIX shared memory name
+ * @return segment, NULL if missing or of another version
+ */
+live_stats_segment* live_attach(const char* name)
+{
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd == -1)
+        return NULL;
+    live_stats_segment* seg = mmap(NULL, sizeof(live_stats_segment), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (seg == MAP_FAILED)
+        return NULL;
+    if (seg->magic != LIVE_STATS_MAGIC || seg->version != LIVE_STATS_VERSION)
+    {
+        munmap(seg, sizeof(live_stats_segment));
+        return NULL;
+    }
+    return seg;
+}
+
+/**
+ * Take a consistent snapshot of a segment, retrying while the writer is active
+ * @param seg: mapped segment
+ * @param out: snapshot
+ * @return number of retries, -1 if the writer stayed in an update for
+ *         LIVE_STATS_MAX_RETRIES attempts (e.g. it died while publishing)
+ */
+int live_read(live_stats_segment* seg, live_stats_data* out)
+{
+    for (int retries = 0; retries < LIVE_STATS_MAX_RETRIES; retries++)
+    {
+        uint64_t before = atomic_load_explicit(&seg->seq, memory_order_acquire);
+        if ((before & 1) == 0)
+        {
+            memcpy(out, &seg->data, sizeof(live_stats_data));
+            atomic_thread_fence(memory_order_acquire);
+            if (atomic_load_explicit(&seg->seq, memory_order_relaxed) == before)
+                return retries;
+        }
+        usleep(LIVE_STATS_RETRY_US);
+    }
+    return -1;
+}
+
+/**
+ * Unmap and remove the segment
+ * @param ls: publisher
+ */
+void live_close(live_stats* ls)
+{
+    munmap(ls->seg, sizeof(live_stats_segment));
+    shm_unlink(ls->name);
+    free(ls->name);
+    free(ls);
+}
@@ -0,0 +1,66 @@
+#ifndef LIVE_STATS_H
+#define LIVE_STATS_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+#include "cache_stats.h"
+#include "main_memory.h"
+
+#define LIVE_STATS_MAGIC 0x5453564cu
+#define LIVE_STATS_VERSION 1
+#define LIVE_STATS_TRACE_LEN 256
+
+// Records simulated between two publications
+#define LIVE_STATS_INTERVAL 4096
+
+// Reader attempts at a consistent snapshot, and the pause between them in microseconds
+#define LIVE_STATS_MAX_RETRIES 1000
+#define LIVE_STATS_RETRY_US 10
+
+typedef struct live_stats_data
+{
+    int pid;
+    int finished;
+    char mode[8];
+    char trace[LIVE_STATS_TRACE_LEN];
+    uint64_t trace_size;
+    uint64_t trace_offset;
+    uint64_t lines;
+    double elapsed;
+    cache_stats cs;
+    unsigned int mm_w_queries;
+    unsigned int mm_r_queries;
+    unsigned int mm_w_bytes;
+    unsigned int mm_r_bytes;
+} live_stats_data;
+
+// Layout of the shared memory segment; seq is odd while the writer updates data
+typedef struct live_stats_segment
+{
+    uint32_t magic;
+    uint32_t version;
+    _Atomic uint64_t seq;
+    live_stats_data data;
+} live_stats_segment;
+
+typedef struct live_stats
+{
+    char* name;
+    live_stats_segment* seg;
+    double start;
+    unsigned int countdown;
+} live_stats;
+
+live_stats* live_open(const char* name, const char* mode, const char* trace);
+
+void live_publish(live_stats* ls, cache_stats* cs, main_memory* mm, uint64_t offset,
+                  uint64_t lines, int finished);
+
+live_stats_segment* live_attach(const char* name);
+
+int live_read(live_stats_segment* seg, live_stats_data* out);
+
+void live_close(live_stats* ls);
+
+#endif
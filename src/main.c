@@ -2,17 +2,19 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <limits.h>
 
 #include "main_memory.h"
-#include "simple.h"
-#include "direct_mapped.h"
-#include "fully_associative.h"
-#include "set_associative.h"
-
-#define MODE_SC 0
-#define MODE_DMC 1
-#define MODE_FAC 2
-#define MODE_SAC 3
+#include "cache.h"
+#include "checkpoint.h"
+#include "sampling.h"
+#include "mshr.h"
+#include "tlb.h"
+#include "fastfwd.h"
+#include "live_stats.h"
+#include "server.h"
+#include "trace_reader.h"
+#include "differential.h"
 
 void print_stats(main_memory* mm, cache_stats cs)
 {   
@@ -35,125 +37,730 @@ void print_stats(main_memory* mm, cache_stats cs)
     printf("*******************************************\n");
 }
 
-int main(int argc, char* argv[])
+void print_icache_stats(cache_stats cs)
+{
+    unsigned int hits = cs.r_queries - cs.r_misses;
+    printf("Fetch Hit Rate:\t\t%.0lf%% (%u/%u)\n",
+           cs.r_queries ? (double) hits / cs.r_queries * 100 : 0, hits, cs.r_queries);
+    printf("I-Cache Fills:\t\t%u\n", cs.r_misses);
+    printf("*******************************************\n");
+}
+
+void print_tenant_stats(set_associative_cache* sac)
 {
-    if (argc != 3)
+    for (int t = 0; t < SET_ASSOCIATIVE_MAX_TENANTS; t++)
     {
-        fprintf(stderr, "Usage: %s sc|dmc|fac|sac input_file\n", argv[0]);
-        exit(1);
+        cache_stats cs = sac->tenant_cs[t];
+        unsigned int queries = cs.w_queries + cs.r_queries;
+        if (queries == 0)
+            continue;
+        unsigned int hits = queries - cs.w_misses - cs.r_misses;
+        printf("Tenant %d Hit Rate:\t%.0lf%% (%u/%u), ways 0x%x\n", t,
+               (double) hits / queries * 100, hits, queries, sac->way_mask[t]);
     }
-    
-    int mode;
-    if (strcmp(argv[1], "sc") == 0)
-        mode = MODE_SC;
-    else if (strcmp(argv[1], "dmc") == 0)
-        mode = MODE_DMC;
-    else if (strcmp(argv[1], "fac") == 0)
-        mode = MODE_FAC;
-    else if (strcmp(argv[1], "sac") == 0)
-        mode = MODE_SAC;
+    if (sac->ucp)
+        printf("Repartitions:\t\t%u\n", sac->ucp->repartitions);
+    printf("*******************************************\n");
+}
+
+void print_set_hist(cache* c, int index_fn)
+{
+    set_stats* hist = cache_set_hist(c);
+    int num_sets = cache_num_sets(c);
+    unsigned int total = 0, max = 0, evictions = 0;
+
+    printf("Index Function:\t\t%s\n", idx_name(index_fn));
+    printf("Set\tQueries\tMisses\tEvicts\tValid\n");
+    for (int i = 0; i < num_sets; i++)
+    {
+        printf("%d\t%u\t%u\t%u\t%d\n", i, hist[i].queries, hist[i].misses,
+               hist[i].evictions, cache_set_occupancy(c, i));
+        total += hist[i].queries;
+        evictions += hist[i].evictions;
+        if (hist[i].queries > max)
+            max = hist[i].queries;
+    }
+    printf("Max/Mean Set Load:\t%.2lf\n", total ? (double) max * num_sets / total : 0);
+    printf("Evictions:\t\t%u\n", evictions);
+    printf("*******************************************\n");
+}
+
+void print_traffic(main_memory* mm)
+{
+    printf("Bytes Written to MM:\t%u\n", mm->w_bytes);
+    printf("Bytes Read from MM:\t%u\n", mm->r_bytes);
+    printf("*******************************************\n");
+}
+
+void print_op_stats(cache_op_stats ops)
+{
+    printf("Non-temporal Loads:\t%u\n", ops.nt_loads);
+    printf("Non-temporal Stores:\t%u\n", ops.nt_stores);
+    printf("Cleans:\t\t\t%u\n", ops.cleans);
+    printf("Invalidates:\t\t%u\n", ops.invalidates);
+    printf("Clean+Invalidates:\t%u\n", ops.clean_invalidates);
+    printf("Flushes:\t\t%u\n", ops.flushes);
+    printf("Maintenance MM Writes:\t%u\n", ops.maint_w_queries);
+    printf("Maintenance MM Bytes:\t%u\n", ops.maint_w_bytes);
+    printf("*******************************************\n");
+}
+
+void simulate_access(cache* c, char RW, void* addr, unsigned int val, int verbose)
+{
+    val = cache_access(c, RW, addr, val);
+    if (!verbose)
+        return;
+    if (RW == 'W' || RW == 'S')
+        printf("%s to %p: %d\n\n", RW == 'S' ? "Streamed" : "Wrote", addr, val);
+    else if (RW == 'C' || RW == 'V' || RW == 'X')
+        printf("%s %p\n\n", RW == 'C' ? "Cleaned" : RW == 'V' ? "Invalidated" : "Cleaned and invalidated", addr);
+    else if (RW == 'F')
+        printf("Flushed cache\n\n");
     else
+        printf("%s from %p: %d\n\n", RW == 'I' ? "Fetched" : RW == 'L' ? "Streamed" : "Read", addr, val);
+}
+
+int parse_geometry(char* arg, int* sets, int* ways)
+{
+    if (sscanf(arg, "%dx%d", sets, ways) != 2 || *sets < 0 || *ways < 0)
+        return 0;
+    // sets are indexed with a mask
+    return (*sets & (*sets - 1)) == 0 && (*sets == 0) == (*ways == 0);
+}
+
+int parse_rate(char* arg, double* rate)
+{
+    char* end;
+    *rate = strtod(arg, &end);
+    return end != arg && *end == '\0';
+}
+
+int parse_count(char* arg, int* count)
+{
+    char* end;
+    long value = strtol(arg, &end, 10);
+    *count = (int) value;
+    return end != arg && *end == '\0' && value >= 1 && value <= INT_MAX;
+}
+
+void usage(char* prog)
+{
+    fprintf(stderr, "Usage: %s sc|dmc|fac|sac input_file [options]\n"
+                    "       %s sc|dmc|fac|sac --serve socket_path [--shared] [--mm-init file] [--huge-pages]\n"
+                    "  -q                        only print final statistics\n"
+                    "  --save-checkpoint N file  snapshot state after trace line N\n"
+                    "  --restore-checkpoint file resume from a snapshot\n"
+                    "  --skip N                  start at access N (seeks in binary and packed traces)\n"
+                    "  --sample-sets RATE        simulate a hashed fraction of sets (dmc, sac)\n"
+                    "  --shards RATE             estimate miss-ratio curve from sampled blocks\n"
+                    "  --sectored                per-word valid/dirty bits, partial fills (sac)\n"
+                    "  --compressed              BDI/FPC compressed lines, 2x tags per set (sac)\n"
+                    "  --dram open|closed        model DRAM banks with the given page policy\n"
+                    "  --dram-map row|block      DRAM address interleaving (default row)\n"
+                    "  --mshr N                  non-blocking cache with N MSHRs\n"
+                    "  --mem-latency L           miss latency in cycles for --mshr (default 100)\n"
+                    "  --way-mask T:MASK         ways tenant T may allocate into, 0 to bypass (sac)\n"
+                    "  --ucp INTERVAL            utility-based way partitioning (sac)\n"
+                    "  --index modulo|xor|prime|skewed  set index function (dmc, sac; skewed: sac)\n"
+                    "  --set-hist                per-set load, miss and eviction histogram\n"
+                    "  --tlb                     translate through L1/L2 TLBs and page walks\n"
+                    "  --page-size 4k|2m|1g      page size for --tlb (default 4k)\n"
+                    "  --tlb-l1 SETSxWAYS        L1 TLB geometry (default 4x4)\n"
+                    "  --tlb-l2 SETSxWAYS        L2 TLB geometry, 0x0 for none (default 16x8)\n"
+                    "  --icache dmc|fac|sac      separate L1 instruction cache for I records\n"
+                    "  --l2 SETSxWAYS            unified L2 below the L1 caches (e.g. 32x8)\n"
+                    "  --fast-forward WINDOW     skip repeating periods of up to WINDOW records (-q; dmc, fac, sac)\n"
+                    "  --publish NAME            publish live stats to POSIX shared memory NAME\n"
+                    "  --self-profile            hardware counters per parse/lookup/fill/update phase\n"
+                    "  --mm-init file            initial memory image (default mm_init.data)\n"
+                    "  --huge-pages              back the memory image and cache lines with huge pages\n"
+                    "  --nt-policy lru|bypass    non-temporal misses fill at LRU or bypass (default lru)\n"
+                    "  --hotness N               top N blocks, regions and conflict pairs by misses\n"
+                    "  --hotness-region BYTES    region size for --hotness (default 4096)\n"
+                    "  --hotness-folded file     write --hotness misses as folded stacks for flamegraphs\n"
+                    "  --diff MODE[,OPT...]      run configuration B in lockstep and report where it diverges;\n"
+                    "                            OPT is index=FN, ways=N, sectored, compressed or nt=POLICY\n"
+                    "  --diff-region BYTES       region size for --diff (default 4096)\n"
+                    "  --diff-interval N         accesses per interval for --diff (default 100000)\n"
+                    "  --diff-log file           write each diverging access for --diff\n",
+            prog, prog);
+    exit(1);
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3)
+        usage(argv[0]);
+    
+    int mode = cache_parse_mode(argv[1]);
+    if (mode == -1)
     {
         fprintf(stderr, "Error: Mode must be sc, dmc, fac, or sac.\n");
         exit (2);
     }
+
+    // Daemon mode: access batches arrive over a socket instead of a trace file
+    if (strcmp(argv[2], "--serve") == 0)
+    {
+        if (argc < 4)
+            usage(argv[0]);
+        int shared = 0;
+        int huge_pages = 0;
+        char* mm_path = 0;
+        for (int i = 4; i < argc; i++)
+        {
+            if (strcmp(argv[i], "--shared") == 0)
+                shared = 1;
+            else if (strcmp(argv[i], "--huge-pages") == 0)
+                huge_pages = 1;
+            else if (strcmp(argv[i], "--mm-init") == 0 && i + 1 < argc)
+                mm_path = argv[++i];
+            else
+                usage(argv[0]);
+        }
+        return server_run(mode, argv[3], shared, mm_path, huge_pages);
+    }
+
+    int verbose = 1;
+    unsigned int save_line = 0;
+    char* save_path = 0;
+    char* restore_path = 0;
+    unsigned int skip = 0;
+    double set_rate = 0;
+    double shards_rate = 0;
+    int sectored = 0;
+    int compressed = 0;
+    int dram_policy = -1;
+    int dram_mapping = DRAM_MAP_ROW;
+    int mshr_entries = 0;
+    unsigned int mem_latency = MSHR_DEFAULT_LATENCY;
+    int use_tlb = 0;
+    int partitioned = 0;
+    unsigned int way_masks[SET_ASSOCIATIVE_MAX_TENANTS];
+    unsigned int ucp_interval = 0;
+    int index_fn = INDEX_MODULO;
+    int set_hist = 0;
+    int page_shift = TLB_PAGE_4K;
+    int l1_sets = TLB_L1_NUM_SETS, l1_ways = TLB_L1_NUM_WAYS;
+    int l2_sets = TLB_L2_NUM_SETS, l2_ways = TLB_L2_NUM_WAYS;
+    int icache_mode = -1;
+    int unified_sets = 0, unified_ways = 0;
+    unsigned long ff_window = 0;
+    char* publish_name = 0;
+    int self_profile = 0;
+    char* mm_path = 0;
+    int huge_pages = 0;
+    int nt_policy = NT_INSERT_LRU;
+    int hot_top = 0;
+    int hot_region = HOT_DEFAULT_REGION;
+    char* hot_folded = 0;
+    char* diff_spec = 0;
+    int diff_region = DIFF_DEFAULT_REGION;
+    unsigned long diff_interval = DIFF_DEFAULT_INTERVAL;
+    char* diff_log = 0;
+    for (int i = 3; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-q") == 0)
+            verbose = 0;
+        else if (strcmp(argv[i], "--save-checkpoint") == 0 && i + 2 < argc)
+        {
+            save_line = strtoul(argv[++i], 0, 0);
+            save_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--restore-checkpoint") == 0 && i + 1 < argc)
+            restore_path = argv[++i];
+        else if (strcmp(argv[i], "--skip") == 0 && i + 1 < argc)
+            skip = strtoul(argv[++i], 0, 0);
+        else if (strcmp(argv[i], "--sample-sets") == 0 && i + 1 < argc)
+        {
+            if (!parse_rate(argv[++i], &set_rate))
+                usage(argv[0]);
+        }
+        else if (strcmp(argv[i], "--shards") == 0 && i + 1 < argc)
+        {
+            if (!parse_rate(argv[++i], &shards_rate))
+                usage(argv[0]);
+        }
+        else if (strcmp(argv[i], "--sectored") == 0)
+            sectored = 1;
+        else if (strcmp(argv[i], "--compressed") == 0)
+            compressed = 1;
+        else if (strcmp(argv[i], "--mshr") == 0 && i + 1 < argc)
+        {
+            if (!parse_count(argv[++i], &mshr_entries))
+            {
+                fprintf(stderr, "Error: Number of MSHRs must be positive.\n");
+                exit(2);
+            }
+        }
+        else if (strcmp(argv[i], "--mem-latency") == 0 && i + 1 < argc)
+            mem_latency = strtoul(argv[++i], 0, 0);
+        else if (strcmp(argv[i], "--way-mask") == 0 && i + 1 < argc)
+        {
+            int tenant;
+            unsigned int mask;
+            if (sscanf(argv[++i], "%d:%x", &tenant, &mask) != 2
+                || tenant < 0 || tenant >= SET_ASSOCIATIVE_MAX_TENANTS)
+                usage(argv[0]);
+            partitioned |= 1 << tenant;
+            way_masks[tenant] = mask;
+        }
+        else if (strcmp(argv[i], "--ucp") == 0 && i + 1 < argc)
+            ucp_interval = strtoul(argv[++i], 0, 0);
+        else if (strcmp(argv[i], "--index") == 0 && i + 1 < argc)
+        {
+            index_fn = idx_parse(argv[++i]);
+            if (index_fn == -1)
+                usage(argv[0]);
+        }
+        else if (strcmp(argv[i], "--set-hist") == 0)
+            set_hist = 1;
+        else if (strcmp(argv[i], "--tlb") == 0)
+            use_tlb = 1;
+        else if (strcmp(argv[i], "--page-size") == 0 && i + 1 < argc)
+        {
+            ++i;
+            if (strcmp(argv[i], "4k") == 0)
+                page_shift = TLB_PAGE_4K;
+            else if (strcmp(argv[i], "2m") == 0)
+                page_shift = TLB_PAGE_2M;
+            else if (strcmp(argv[i], "1g") == 0)
+                page_shift = TLB_PAGE_1G;
+            else
+                usage(argv[0]);
+        }
+        else if (strcmp(argv[i], "--tlb-l1") == 0 && i + 1 < argc)
+        {
+            if (!parse_geometry(argv[++i], &l1_sets, &l1_ways) || l1_sets == 0)
+                usage(argv[0]);
+        }
+        else if (strcmp(argv[i], "--tlb-l2") == 0 && i + 1 < argc)
+        {
+            if (!parse_geometry(argv[++i], &l2_sets, &l2_ways))
+                usage(argv[0]);
+        }
+        else if (strcmp(argv[i], "--icache") == 0 && i + 1 < argc)
+        {
+            icache_mode = cache_parse_mode(argv[++i]);
+            if (icache_mode == -1 || icache_mode == MODE_SC)
+                usage(argv[0]);
+        }
+        else if (strcmp(argv[i], "--l2") == 0 && i + 1 < argc)
+        {
+            if (!parse_geometry(argv[++i], &unified_sets, &unified_ways) || unified_sets == 0)
+                usage(argv[0]);
+        }
+        else if (strcmp(argv[i], "--fast-forward") == 0 && i + 1 < argc)
+        {
+            ff_window = strtoul(argv[++i], 0, 0);
+            if (ff_window == 0)
+                usage(argv[0]);
+        }
+        else if (strcmp(argv[i], "--self-profile") == 0)
+            self_profile = 1;
+        else if (strcmp(argv[i], "--mm-init") == 0 && i + 1 < argc)
+            mm_path = argv[++i];
+        else if (strcmp(argv[i], "--huge-pages") == 0)
+            huge_pages = 1;
+        else if (strcmp(argv[i], "--diff") == 0 && i + 1 < argc)
+            diff_spec = argv[++i];
+        else if (strcmp(argv[i], "--diff-region") == 0 && i + 1 < argc)
+            diff_region = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--diff-interval") == 0 && i + 1 < argc)
+            diff_interval = strtoul(argv[++i], 0, 0);
+        else if (strcmp(argv[i], "--diff-log") == 0 && i + 1 < argc)
+            diff_log = argv[++i];
+        else if (strcmp(argv[i], "--hotness") == 0 && i + 1 < argc)
+        {
+            if (!parse_count(argv[++i], &hot_top))
+            {
+                fprintf(stderr, "Error: Number of hotness rows must be positive.\n");
+                exit(2);
+            }
+        }
+        else if (strcmp(argv[i], "--hotness-region") == 0 && i + 1 < argc)
+            hot_region = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--hotness-folded") == 0 && i + 1 < argc)
+            hot_folded = argv[++i];
+        else if (strcmp(argv[i], "--nt-policy") == 0 && i + 1 < argc)
+        {
+            ++i;
+            if (strcmp(argv[i], "lru") == 0)
+                nt_policy = NT_INSERT_LRU;
+            else if (strcmp(argv[i], "bypass") == 0)
+                nt_policy = NT_BYPASS;
+            else
+                usage(argv[0]);
+        }
+        else if (strcmp(argv[i], "--publish") == 0 && i + 1 < argc)
+            publish_name = argv[++i];
+        else if (strcmp(argv[i], "--dram") == 0 && i + 1 < argc)
+        {
+            ++i;
+            if (strcmp(argv[i], "open") == 0)
+                dram_policy = DRAM_POLICY_OPEN;
+            else if (strcmp(argv[i], "closed") == 0)
+                dram_policy = DRAM_POLICY_CLOSED;
+            else
+                usage(argv[0]);
+        }
+        else if (strcmp(argv[i], "--dram-map") == 0 && i + 1 < argc)
+        {
+            ++i;
+            if (strcmp(argv[i], "row") == 0)
+                dram_mapping = DRAM_MAP_ROW;
+            else if (strcmp(argv[i], "block") == 0)
+                dram_mapping = DRAM_MAP_BLOCK;
+            else
+                usage(argv[0]);
+        }
+        else
+            usage(argv[0]);
+    }
+    
+    // Written as negated ranges so that NaN is rejected too
+    if (!(set_rate >= 0 && set_rate <= 1) || !(shards_rate >= 0 && shards_rate <= 1))
+    {
+        fprintf(stderr, "Error: Sampling rates must be in [0, 1].\n");
+        exit(2);
+    }
+    if (set_rate > 0 && mode != MODE_DMC && mode != MODE_SAC)
+    {
+        fprintf(stderr, "Error: Set sampling requires dmc or sac mode.\n");
+        exit(2);
+    }
+    if (use_tlb && set_rate > 0)
+    {
+        fprintf(stderr, "Error: Page walks cannot be combined with set sampling.\n");
+        exit(2);
+    }
+    if ((partitioned || ucp_interval > 0) && mode != MODE_SAC)
+    {
+        fprintf(stderr, "Error: Way partitioning requires sac mode.\n");
+        exit(2);
+    }
+    if ((index_fn != INDEX_MODULO || set_hist) && mode != MODE_DMC && mode != MODE_SAC)
+    {
+        fprintf(stderr, "Error: Set index functions require dmc or sac mode.\n");
+        exit(2);
+    }
+    if (index_fn == INDEX_SKEWED && (mode != MODE_SAC || partitioned || ucp_interval > 0 || set_rate > 0))
+    {
+        fprintf(stderr, "Error: Skewed indexing requires sac mode without partitioning or set sampling.\n");
+        exit(2);
+    }
+    if (sectored && mode != MODE_SAC)
+    {
+        fprintf(stderr, "Error: Sectored lines require sac mode.\n");
+        exit(2);
+    }
+    if (compressed && (mode != MODE_SAC || sectored || partitioned || ucp_interval > 0
+                       || index_fn == INDEX_SKEWED || save_path || restore_path))
+    {
+        fprintf(stderr, "Error: Compressed lines require sac mode without sectoring, "
+                        "partitioning, skewed indexing or checkpoints.\n");
+        exit(2);
+    }
+    if (use_tlb && (save_path || restore_path))
+    {
+        fprintf(stderr, "Error: Checkpoints do not cover TLB state.\n");
+        exit(2);
+    }
+    if (dram_policy != -1 && (save_path || restore_path))
+    {
+        fprintf(stderr, "Error: Checkpoints do not cover DRAM state.\n");
+        exit(2);
+    }
+    if (mshr_entries > 0 && (save_path || restore_path))
+    {
+        fprintf(stderr, "Error: Checkpoints do not cover MSHR state.\n");
+        exit(2);
+    }
+    if ((set_rate > 0 || shards_rate > 0) && (save_path || restore_path))
+    {
+        fprintf(stderr, "Error: Checkpoints do not cover set sampling or SHARDS state.\n");
+        exit(2);
+    }
+    if ((partitioned || ucp_interval > 0) && (save_path || restore_path))
+    {
+        fprintf(stderr, "Error: Checkpoints do not cover way partitions or UCP.\n");
+        exit(2);
+    }
+    if ((icache_mode != -1 || unified_sets > 0) && (save_path || restore_path))
+    {
+        fprintf(stderr, "Error: Checkpoints do not cover the I-cache or L2.\n");
+        exit(2);
+    }
+    if (skip > 0 && restore_path)
+    {
+        fprintf(stderr, "Error: A restored checkpoint already sets the starting line.\n");
+        exit(2);
+    }
+    if (icache_mode != -1 && set_rate > 0)
+    {
+        fprintf(stderr, "Error: Set sampling requires a single L1 cache.\n");
+        exit(2);
+    }
+    if (hot_region < MAIN_MEMORY_BLOCK_SIZE || (hot_region & (hot_region - 1)) != 0)
+    {
+        fprintf(stderr, "Error: Hotness regions must be a power of two of at least %d bytes.\n",
+                MAIN_MEMORY_BLOCK_SIZE);
+        exit(2);
+    }
+    if (diff_region < MAIN_MEMORY_BLOCK_SIZE || diff_region > MAIN_MEMORY_SIZE
+        || (diff_region & (diff_region - 1)) != 0 || diff_interval == 0)
+    {
+        fprintf(stderr, "Error: Diff regions must be a power of two from %d to %d bytes "
+                        "and intervals positive.\n", MAIN_MEMORY_BLOCK_SIZE, MAIN_MEMORY_SIZE);
+        exit(2);
+    }
+    if (diff_spec && (save_path || restore_path || set_rate > 0 || icache_mode != -1 || unified_sets > 0
+                      || use_tlb))
+    {
+        fprintf(stderr, "Error: Differential runs require a single L1 cache without checkpoints, "
+                        "set sampling or TLB.\n");
+        exit(2);
+    }
+    if (ff_window > 0 && (verbose || mode == MODE_SC || save_path || restore_path || set_rate > 0 || shards_rate > 0
+                          || use_tlb || mshr_entries > 0 || dram_policy != -1 || compressed
+                          || ucp_interval > 0 || icache_mode != -1 || unified_sets > 0 || hot_top > 0 || hot_folded || diff_spec))
+    {
+        fprintf(stderr, "Error: Fast-forward requires -q and a single dmc, fac or sac cache "
+                        "without timing, sampling, TLB, compression, UCP, hotness, diff or extra levels.\n");
+        exit(2);
+    }
     
-    FILE* input_file = fopen(argv[2], "r");
-    if (input_file == 0)
+    trace_reader* tr = tr_open(argv[2]);
+    if (tr == 0)
     {
         fprintf(stderr, "Error: Could not open %s.\n", argv[2]);
         exit(3);
     }
     
-    main_memory* mm = mm_init();
-    simple_cache* sc = 0;
-    direct_mapped_cache* dmc = 0;
-    fully_associative_cache* fac = 0;
-    set_associative_cache* sac = 0;
-    if (mode == MODE_SC)
-        sc = sc_init(mm);
-    else if (mode == MODE_DMC)
-        dmc = dmc_init(mm);
-    else if (mode == MODE_FAC)
-        fac = fac_init(mm);
-    else if (mode == MODE_SAC)
-        sac = sac_init(mm);
+    main_memory* mm = mm_init(mm_path);
+    mm->verbose = verbose;
+    if (huge_pages)
+    {
+        mb_use_huge_pages(1);
+        if (!mm_use_huge_pages(mm))
+            fprintf(stderr, "Warning: No hugetlb pages reserved, using transparent huge pages.\n");
+    }
+    if (dram_policy != -1)
+        mm->dram = dram_init(dram_policy, dram_mapping);
+    if (unified_sets > 0)
+        mm->l2 = unified_init(unified_sets, unified_ways);
+    cache* c = cache_init(mode, mm);
+    cache_stats* cs = cache_get_stats(c);
+    cache* ic = icache_mode != -1 ? cache_init(icache_mode, mm) : 0;
+    if (sectored)
+        c->sac->sectored = 1;
+    if (compressed)
+        sac_enable_compression(c->sac);
+    cache_set_index_fn(c, index_fn);
+    for (int t = 0; t < SET_ASSOCIATIVE_MAX_TENANTS; t++)
+        if (partitioned & (1 << t))
+            sac_set_way_mask(c->sac, t, way_masks[t]);
+    if (ucp_interval > 0)
+        sac_enable_ucp(c->sac, ucp_interval);
+    int multi_tenant = partitioned || ucp_interval > 0;
+    set_sampler* ss = set_rate > 0 ? ss_init(cache_num_sets(c), set_rate) : 0;
+    shards_sampler* sh = shards_rate > 0 ? shards_init(shards_rate) : 0;
+    mshr_file* ms = mshr_entries > 0 ? mshr_init(mshr_entries, mem_latency) : 0;
+    fast_forward* ff = ff_window > 0 ? ff_init(c, mm, ff_window) : 0;
+    tlb* tl = use_tlb ? tlb_init(c, page_shift, l1_sets, l1_ways, l2_sets, l2_ways) : 0;
+    live_stats* ls = publish_name ? live_open(publish_name, argv[1], argv[2]) : 0;
+    selfprof* sp = self_profile ? sp_init() : 0;
+    hotness* hp = hot_top > 0 || hot_folded ? hot_init(hot_region) : 0;
+    cache_set_hotness(c, hp);
+    diff_sim* df = 0;
+    if (diff_spec)
+    {
+        df = diff_init(diff_spec, mm_path, diff_region, diff_interval);
+        if (df == 0)
+        {
+            fprintf(stderr, "Error: Invalid --diff configuration %s.\n", diff_spec);
+            exit(2);
+        }
+        if (diff_log)
+            diff_open_log(df, diff_log);
+    }
+    cache_set_profiler(c, sp);
+    cache_set_nt_policy(c, nt_policy);
+    if (ic)
+    {
+        cache_set_profiler(ic, sp);
+        cache_set_nt_policy(ic, nt_policy);
+    }
     
-    char* line = 0;
-    size_t line_len = 0;
-    unsigned int line_num = 0;
-    while (getline(&line, &line_len, input_file) != -1)
-    {
-        ++line_num;
-        
-        char RW;
-        void* addr;
-        unsigned int val;
-        
-        int tolkens_found = sscanf(line, "%c %p %d", &RW, &addr, &val);
-
-        if (strlen(line) != 1 && RW != '#')
-        {
-            if ((RW != 'R' && RW != 'W')
-                || (RW == 'R' && tolkens_found != 2)
-                || (RW == 'W' && tolkens_found !=3))
-                fprintf(stderr, "Warning: Format error on line %d: %s", line_num,
-                        line);
-            else
+    if (restore_path)
+    {
+        long trace_offset;
+        unsigned int line_num;
+        ckpt_restore(restore_path, c, mm, &trace_offset, &line_num);
+        // Tagged records before the checkpoint already call for tenant statistics
+        for (int t = 1; mode == MODE_SAC && t < SET_ASSOCIATIVE_MAX_TENANTS; t++)
+            if (c->sac->tenant_cs[t].w_queries + c->sac->tenant_cs[t].r_queries > 0)
+                multi_tenant = 1;
+        if (tr_seek(tr, trace_offset, line_num) != 0)
+        {
+            fprintf(stderr, "Error: Could not seek %s to checkpoint offset.\n", argv[2]);
+            exit(3);
+        }
+    }
+    if (skip > 0)
+        tr_skip(tr, skip);
+
+    char RW;
+    void* addr;
+    unsigned int val;
+    int tenant;
+    int status;
+
+    // Reading and parsing a line, up to the access, is the parse phase
+    if (sp)
+        sp_switch(sp, SP_PARSE);
+    while ((status = tr_next(tr, &RW, &addr, &val, &tenant)) != TRACE_READ_EOF)
+    {
+        if (ls)
+            live_publish(ls, cs, mm, tr->offset, tr->line_num, 0);
+        unsigned long cycles = 1;
+
+        if (status == TRACE_READ_ACCESS)
+        {
+            if (tenant != 0)
+                multi_tenant = 1;
+            if (mode == MODE_SAC)
+                c->sac->tenant = tenant;
+
+            // Records inside a repeating period are only compared, not simulated
+            if (ff && ff_skip(ff, RW, addr, val, tenant))
+                continue;
+
+            // Maintenance reaches every set and both L1 caches; F has no address
+            int maintenance = strchr("CVXF", RW) != NULL;
+            if (tl && RW != 'F')
+                addr = tlb_translate(tl, addr);
+            if (sh && !maintenance)
+                shards_access(sh, addr);
+
+            // Accesses to sets outside the sample are not simulated at all
+            int set_index = ss && !maintenance ? cache_set_index(c, addr) : -1;
+            if (set_index == -1 || ss_is_sampled(ss, set_index))
             {
-                if (RW == 'W')
-                {
-                    if (mode == MODE_SC)
-                        sc_store_word(sc, addr, val);
-                    else if (mode == MODE_DMC)
-                        dmc_store_word(dmc, addr, val);
-                    else if (mode == MODE_FAC)
-                        fac_store_word(fac, addr, val);
-                    else if (mode == MODE_SAC)
-                        sac_store_word(sac, addr, val);
-                    printf("Wrote to %p: %d\n\n", addr, val);
-                }
-                else
-                {
-                    if (mode == MODE_SC)
-                        val = sc_load_word(sc, addr);
-                    else if (mode == MODE_DMC)
-                        val = dmc_load_word(dmc, addr);
-                    else if (mode == MODE_FAC)
-                        val = fac_load_word(fac, addr);
-                    else if (mode == MODE_SAC)
-                        val = sac_load_word(sac, addr);
-                    printf("Read from %p: %d\n\n", addr, val);
-                }
+                // Instruction fetches go to the I-cache when the L1 is split
+                cache* side = RW == 'I' && ic ? ic : c;
+                cache_stats* side_cs = cache_get_stats(side);
+                unsigned int misses = side_cs->w_misses + side_cs->r_misses;
+                if (sp)
+                    sp_switch(sp, SP_LOOKUP);
+                simulate_access(side, RW, addr, val, verbose);
+                if (maintenance && ic)
+                    cache_access(ic, RW, addr, val);
+                if (sp)
+                    sp_switch(sp, SP_OTHER);
+                int was_miss = side_cs->w_misses + side_cs->r_misses != misses;
+                if (hp && side == c && !maintenance)
+                    hot_access(hp, addr, was_miss);
+                if (df)
+                    diff_access(df, RW, addr, val, tenant, was_miss, tr->line_num);
+                if (ff)
+                    ff_record_access(ff, RW, addr, val, tenant);
+                if (ss && !maintenance)
+                    ss_record(ss, set_index, was_miss);
+                if (ms && !maintenance)
+                    cycles = mshr_access(ms, addr, was_miss);
             }
         }
-        
+
+        // Every trace line takes one memory controller cycle to issue, plus MSHR stalls
+        if (mm->dram)
+            dram_tick(mm->dram, cycles);
+
+        if (save_path && tr->line_num == save_line)
+            ckpt_save(save_path, c, mm, tr->offset, tr->line_num);
+        if (sp)
+            sp_switch(sp, SP_PARSE);
     }
-    free(line);
-    
-    fclose(input_file);
+    if (ff)
+        ff_finish(ff);
+    if (ls)
+        live_publish(ls, cs, mm, tr->offset, tr->line_num, 1);
+    tr_close(tr);
     
-    if (mode == MODE_SC)
+    print_stats(mm, *cs);
+    if (c->ops.nt_loads || c->ops.nt_stores || c->ops.cleans || c->ops.invalidates
+        || c->ops.clean_invalidates || c->ops.flushes)
+        print_op_stats(c->ops);
+    if (sectored)
+        print_traffic(mm);
+    if (compressed)
+        comp_print(c->sac->comp, cs);
+    if (ic)
     {
-        print_stats(mm, sc->cs);
-        sc_free(sc);
+        print_icache_stats(*cache_get_stats(ic));
+        cache_free(ic);
     }
-    else if (mode == MODE_DMC)
+    if (mm->l2)
     {
-        print_stats(mm, dmc->cs);
-        dmc_free(dmc);
+        unified_print(mm->l2);
+        unified_free(mm->l2);
     }
-    else if (mode == MODE_FAC)
+    if (set_hist)
+        print_set_hist(c, index_fn);
+    if (df)
     {
-        print_stats(mm, fac->cs);
-        fac_free(fac);
+        diff_print(df);
+        diff_free(df);
     }
-    else if (mode == MODE_SAC)
+    if (hp)
     {
-        print_stats(mm, sac->cs);
-        sac_free(sac);
+        if (hot_top > 0)
+            hot_print(hp, hot_top);
+        if (hot_folded)
+            hot_write_folded(hp, hot_folded);
+        hot_free(hp);
     }
+    if (mode == MODE_SAC && multi_tenant)
+        print_tenant_stats(c->sac);
+    if (tl)
+    {
+        tlb_print(tl);
+        tlb_free(tl);
+    }
+    if (ms)
+    {
+        mshr_print(ms);
+        mshr_free(ms);
+    }
+    if (mm->dram)
+    {
+        dram_print(mm->dram);
+        dram_free(mm->dram);
+    }
+    if (ss)
+    {
+        ss_print(ss, mm);
+        ss_free(ss);
+    }
+    if (sh)
+    {
+        shards_print(sh);
+        shards_free(sh);
+    }
+    if (ff)
+    {
+        ff_print(ff);
+        ff_free(ff);
+    }
+    if (sp)
+    {
+        sp_print(sp);
+        sp_free(sp);
+    }
+    if (ls)
+        live_close(ls);
+    cache_free(c);
     mm_free(mm);
     
     return 0;
-}
\ No newline at end of file
+}
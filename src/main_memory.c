@@ -1,39 +1,116 @@
+#define _GNU_SOURCE
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "main_memory.h"
 
-main_memory* mm_init()
+/**
+ * Map the initial memory image copy-on-write, so startup touches no pages
+ * and only blocks that are written get private copies
+ * @param path: memory image, NULL for MAIN_MEMORY_INIT_FILE in the current directory
+ * @return main memory
+ */
+main_memory* mm_init(const char* path)
 {
-    FILE* input_file = fopen(MAIN_MEMORY_INIT_FILE, "r");
-    if (input_file == 0)
+    const char* file = path ? path : MAIN_MEMORY_INIT_FILE;
+    int fd = open(file, O_RDONLY);
+    if (fd == -1)
     {
         fprintf(stderr, "Error: Could not open %s."
                         " Ensure that file is in the proper directory.\n\n",
-                        MAIN_MEMORY_INIT_FILE);
+                        file);
         exit(1);
     }
 
     main_memory* result = malloc(sizeof(main_memory));
 
-    result->data = malloc(MAIN_MEMORY_SIZE);
-    if (fread(result->data, MAIN_MEMORY_SIZE, 1, input_file) != 1)
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < MAIN_MEMORY_SIZE)
     {
-        fprintf(stderr, "Error: Not enough mem_block in %s.\n\n",
-                MAIN_MEMORY_INIT_FILE);
+        fprintf(stderr, "Error: Not enough mem_block in %s.\n\n", file);
         exit(2);
     }
+    result->data = mmap(NULL, MAIN_MEMORY_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (result->data == MAP_FAILED)
+    {
+        fprintf(stderr, "Error: Could not map %s.\n\n", file);
+        exit(2);
+    }
+    result->map_len = MAIN_MEMORY_SIZE;
     
-    fclose(input_file);
+    close(fd);
     
     result->w_queries = 0;
     result->r_queries = 0;
+    result->w_bytes = 0;
+    result->r_bytes = 0;
+    result->verbose = 1;
+    result->dram = NULL;
+    result->l2 = NULL;
 
     return result;
 }
 
+/**
+ * Move the memory image to huge pages: explicit hugetlb pages if any are
+ * reserved, otherwise an anonymous mapping advised for transparent huge pages
+ * @param mm: pointer to main memory
+ * @return 1 if hugetlb pages are used, 0 for transparent huge pages
+ */
+int mm_use_huge_pages(main_memory* mm)
+{
+    size_t len = (MAIN_MEMORY_SIZE + MAIN_MEMORY_HUGE_PAGE_SIZE - 1)
+                 & ~(size_t) (MAIN_MEMORY_HUGE_PAGE_SIZE - 1);
+    int hugetlb = 1;
+    void* data = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (data == MAP_FAILED)
+    {
+        hugetlb = 0;
+        data = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (data == MAP_FAILED)
+        {
+            fprintf(stderr, "Error: Could not allocate the memory image.\n");
+            exit(2);
+        }
+        madvise(data, len, MADV_HUGEPAGE);
+    }
+    memcpy(data, mm->data, MAIN_MEMORY_SIZE);
+    munmap(mm->data, mm->map_len);
+    mm->data = data;
+    mm->map_len = len;
+    return hugetlb;
+}
+
+/**
+ * Pass an access on to the levels below the caches: the shared L2, if any,
+ * filters which reads and writes reach the DRAM model
+ * @param mm: pointer to main memory
+ * @param addr: address accessed (block or sector)
+ * @param is_write: 1 for a write, 0 for a read
+ */
+static void mm_lower_access(main_memory* mm, void* addr, int is_write)
+{
+    if (mm->l2)
+    {
+        size_t offt = (size_t) (addr - MAIN_MEMORY_START_ADDR) % MAIN_MEMORY_BLOCK_SIZE;
+        void* victim;
+        int fetched = unified_access(mm->l2, addr - offt, is_write, &victim);
+        if (mm->dram && victim)
+            dram_enqueue(mm->dram, victim, 1);
+        if (mm->dram && fetched)
+            dram_enqueue(mm->dram, addr - offt, 0);
+    }
+    else if (mm->dram)
+        dram_enqueue(mm->dram, addr, is_write);
+}
+
 void mm_write(main_memory* mm, void* start_addr, memory_block* mb)
 {
     // start_addr argument must match mb argument's start_addr field
@@ -53,8 +130,11 @@ void mm_write(main_memory* mm, void* start_addr, memory_block* mb)
     
     memcpy(mm->data + (size_t) start_addr - MAIN_MEMORY_START_ADDR, mb->data, mb->size);
     
-    printf("MM: Wrote %zu bytes at %p.\n", mb->size, start_addr);
+    if (mm->verbose)
+        printf("MM: Wrote %zu bytes at %p.\n", mb->size, start_addr);
     ++mm->w_queries;
+    mm->w_bytes += mb->size;
+    mm_lower_access(mm, start_addr, 1);
 }
 
 memory_block* mm_read(main_memory* mm, void* start_addr)
@@ -71,14 +151,54 @@ memory_block* mm_read(main_memory* mm, void* start_addr)
         = mb_new(start_addr, MAIN_MEMORY_BLOCK_SIZE,
                  mm->data + (size_t) start_addr - MAIN_MEMORY_START_ADDR);
         
-    printf("MM: Read %zu bytes at %p.\n", result->size, start_addr);
+    if (mm->verbose)
+        printf("MM: Read %zu bytes at %p.\n", result->size, start_addr);
     ++mm->r_queries;
+    mm->r_bytes += result->size;
+    mm_lower_access(mm, start_addr, 0);
     
     return result;
 }
 
+void mm_write_sector(main_memory* mm, void* addr, void* source, size_t size)
+{
+    // a sector never crosses a MAIN_MEMORY block boundary
+    assert((size_t) (addr - MAIN_MEMORY_START_ADDR) % MAIN_MEMORY_BLOCK_SIZE + size
+           <= MAIN_MEMORY_BLOCK_SIZE);
+    
+    // make sure we are not out of bounds
+    assert(addr >= MAIN_MEMORY_START_ADDR);
+    assert(addr + size <= (void*) MAIN_MEMORY_START_ADDR + MAIN_MEMORY_SIZE);
+    
+    memcpy(mm->data + (size_t) addr - MAIN_MEMORY_START_ADDR, source, size);
+    
+    if (mm->verbose)
+        printf("MM: Wrote %zu bytes at %p.\n", size, addr);
+    ++mm->w_queries;
+    mm->w_bytes += size;
+    mm_lower_access(mm, addr, 1);
+}
+
+void mm_read_sector(main_memory* mm, void* addr, void* dest, size_t size)
+{
+    // a sector never crosses a MAIN_MEMORY block boundary
+    assert((size_t) (addr - MAIN_MEMORY_START_ADDR) % MAIN_MEMORY_BLOCK_SIZE + size
+           <= MAIN_MEMORY_BLOCK_SIZE);
+    
+    // make sure we are not out of bounds
+    assert(addr + size <= (void*) MAIN_MEMORY_START_ADDR + MAIN_MEMORY_SIZE);
+    
+    memcpy(dest, mm->data + (size_t) addr - MAIN_MEMORY_START_ADDR, size);
+    
+    if (mm->verbose)
+        printf("MM: Read %zu bytes at %p.\n", size, addr);
+    ++mm->r_queries;
+    mm->r_bytes += size;
+    mm_lower_access(mm, addr, 0);
+}
+
 void mm_free(main_memory* mm)
 {
-    free(mm->data);
+    munmap(mm->data, mm->map_len);
     free(mm);
 }
\ No newline at end of file
@@ -2,6 +2,8 @@
 #define MAIN_MEMORY_H
 
 #include "memory_block.h"
+#include "dram.h"
+#include "unified.h"
 
 #define MAIN_MEMORY_SIZE 65536
 #define MAIN_MEMORY_SIZE_LN 16
@@ -10,19 +12,34 @@
 #define MAIN_MEMORY_BLOCK_SIZE_LN 5
 #define MAIN_MEMORY_INIT_FILE "mm_init.data"
 
+// Explicit huge page size used for the memory image with --huge-pages
+#define MAIN_MEMORY_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
 typedef struct main_memory
 {
     void* data;
+    size_t map_len;
     unsigned int w_queries;
     unsigned int r_queries;
+    unsigned int w_bytes;
+    unsigned int r_bytes;
+    int verbose;
+    dram* dram;
+    unified_cache* l2;
 } main_memory;
 
-main_memory* mm_init();
+main_memory* mm_init(const char* path);
+
+int mm_use_huge_pages(main_memory* mm);
 
 void mm_write(main_memory* mm, void* start_addr, memory_block* mb);
 
 memory_block* mm_read(main_memory* mm, void* start_addr);
 
+void mm_write_sector(main_memory* mm, void* addr, void* source, size_t size);
+
+void mm_read_sector(main_memory* mm, void* addr, void* dest, size_t size);
+
 void mm_free(main_memory* mm);
 
 #endif
\ No newline at end of file
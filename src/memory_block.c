@@ -1,20 +1,101 @@
+#define _GNU_SOURCE
 #include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
+#include <sys/mman.h>
 
 #include "memory_block.h"
+#include "main_memory.h"
+
+// Block header and line data share one slab object, the data within one cache line
+typedef union slab_object
+{
+    union slab_object* next;
+    struct
+    {
+        memory_block mb;
+        unsigned char data[MAIN_MEMORY_BLOCK_SIZE];
+    } block;
+    unsigned char align[64];
+} slab_object;
+
+static slab_object* free_objects;
+static slab_object* slab_cursor;
+static slab_object* slab_end;
+static int slab_huge_pages;
+
+/**
+ * Back later slabs with huge pages (hugetlb if reserved, else transparent)
+ * @param enable: 1 to use huge pages
+ */
+void mb_use_huge_pages(int enable)
+{
+    slab_huge_pages = enable;
+}
+
+/**
+ * Carve a new slab into objects
+ */
+static void slab_grow()
+{
+    void* slab = MAP_FAILED;
+    if (slab_huge_pages)
+        slab = mmap(NULL, MEMORY_BLOCK_SLAB_SIZE, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (slab == MAP_FAILED)
+    {
+        slab = mmap(NULL, MEMORY_BLOCK_SLAB_SIZE, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (slab == MAP_FAILED)
+        {
+            fprintf(stderr, "Error: Could not allocate memory blocks.\n");
+            exit(2);
+        }
+        if (slab_huge_pages)
+            madvise(slab, MEMORY_BLOCK_SLAB_SIZE, MADV_HUGEPAGE);
+    }
+    slab_cursor = slab;
+    slab_end = slab_cursor + MEMORY_BLOCK_SLAB_SIZE / sizeof(slab_object);
+}
 
 memory_block* mb_new(void* start_addr, size_t size, void* source)
 {
-    memory_block* result = malloc(sizeof(memory_block));
+    memory_block* result;
+    if (size == MAIN_MEMORY_BLOCK_SIZE)
+    {
+        slab_object* obj = free_objects;
+        if (obj)
+            free_objects = obj->next;
+        else
+        {
+            if (slab_cursor == slab_end)
+                slab_grow();
+            obj = slab_cursor++;
+        }
+        result = &obj->block.mb;
+        result->data = obj->block.data;
+    }
+    else
+    {
+        result = malloc(sizeof(memory_block));
+        result->data = malloc(size);
+    }
     result->start_addr = start_addr;
     result->size = size;
-    result->data = malloc(size);
     memcpy(result->data, source, size);
     return result;
 }
 
 void mb_free(memory_block* mb)
 {
+    // Dummy blocks from the cache init functions are malloced without data
+    slab_object* obj = (slab_object*) mb;
+    if (mb->data == obj->block.data)
+    {
+        obj->next = free_objects;
+        free_objects = obj;
+        return;
+    }
     free(mb->data);
     free(mb);
-}
\ No newline at end of file
+}
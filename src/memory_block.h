@@ -3,6 +3,9 @@
 
 #include <stdlib.h>
 
+// Line-sized blocks are carved from slabs of this size
+#define MEMORY_BLOCK_SLAB_SIZE (2 * 1024 * 1024)
+
 typedef struct memory_block
 {
     void* start_addr;
@@ -14,4 +17,6 @@ memory_block* mb_new(void* start_addr, size_t size, void* source);
 
 void mb_free(memory_block* mb);
 
+void mb_use_huge_pages(int enable);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,151 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "main_memory.h"
+#include "mshr.h"
+
+/**
+ * Allocate miss status holding registers for a non-blocking cache
+ * @param num_entries: number of misses that may be outstanding at once
+ * @param miss_latency: cycles until a fill returns from main memory
+ * @return initialized MSHR file
+ */
+mshr_file* mshr_init(int num_entries, unsigned int miss_latency)
+{
+    mshr_file* result = calloc(1, sizeof(mshr_file));
+    result->num_entries = num_entries;
+    result->entries = malloc(num_entries * sizeof(mshr_entry));
+    result->miss_latency = miss_latency;
+    return result;
+}
+
+/**
+ * Index of the outstanding miss that completes first
+ * @param m: pointer to MSHR file with at least one entry in use
+ * @return entry index
+ */
+static int earliest_entry(mshr_file* m)
+{
+    int result = 0;
+    for (int i = 1; i < m->in_use; i++)
+        if (m->entries[i].ready < m->entries[result].ready)
+            result = i;
+    return result;
+}
+
+/**
+ * Move time forward to cycle t, retiring fills that complete on the way and
+ * integrating the number of outstanding misses for the MLP figure
+ * @param m: pointer to MSHR file
+ * @param t: target cycle, not before m->cycle
+ */
+static void advance(mshr_file* m, unsigned long t)
+{
+    while (m->in_use > 0)
+    {
+        int i = earliest_entry(m);
+        unsigned long ready = m->entries[i].ready;
+        if (ready > t)
+            break;
+        if (ready > m->cycle)
+        {
+            m->outstanding_area += m->in_use * (ready - m->cycle);
+            m->busy_cycles += ready - m->cycle;
+            m->cycle = ready;
+        }
+        m->entries[i] = m->entries[--m->in_use];
+    }
+
+    if (m->in_use > 0)
+    {
+        m->outstanding_area += m->in_use * (t - m->cycle);
+        m->busy_cycles += t - m->cycle;
+    }
+    m->cycle = t;
+}
+
+/**
+ * Account for one access issued by the core; one access issues per cycle
+ * Misses to a block that is already being fetched merge into its entry,
+ * new misses only stall the core when every entry is in use
+ * @param m: pointer to MSHR file
+ * @param addr: accessed address
+ * @param was_miss: 1 if the cache reported a miss for this access
+ * @return cycles consumed by the access, including stalls
+ */
+unsigned long mshr_access(mshr_file* m, void* addr, int was_miss)
+{
+    unsigned long start = m->cycle;
+    uint32_t block = (uint32_t) (uintptr_t) addr >> MAIN_MEMORY_BLOCK_SIZE_LN;
+    m->accesses++;
+    m->misses += was_miss;
+
+    // The cache installs blocks immediately, so a secondary miss shows up as a hit
+    for (int i = 0; i < m->in_use; i++)
+    {
+        if (m->entries[i].block == block)
+        {
+            m->merged_misses++;
+            advance(m, m->cycle + 1);
+            return m->cycle - start;
+        }
+    }
+
+    if (was_miss)
+    {
+        if (m->in_use == m->num_entries)
+        {
+            unsigned long ready = m->entries[earliest_entry(m)].ready;
+            m->full_stalls++;
+            m->stall_cycles += ready - m->cycle;
+            advance(m, ready);
+        }
+
+        m->entries[m->in_use].block = block;
+        m->entries[m->in_use].ready = m->cycle + m->miss_latency;
+        m->in_use++;
+        m->primary_misses++;
+    }
+
+    advance(m, m->cycle + 1);
+    return m->cycle - start;
+}
+
+/**
+ * Wait for all outstanding misses to complete
+ * @param m: pointer to MSHR file
+ */
+void mshr_finish(mshr_file* m)
+{
+    while (m->in_use > 0)
+        advance(m, m->entries[earliest_entry(m)].ready);
+}
+
+/**
+ * Print memory-level parallelism and stall statistics
+ * @param m: pointer to MSHR file
+ */
+void mshr_print(mshr_file* m)
+{
+    mshr_finish(m);
+    unsigned long blocking = m->accesses + (unsigned long) m->misses * m->miss_latency;
+
+    printf("MSHRs:\t\t\t%d (miss latency %u)\n", m->num_entries, m->miss_latency);
+    printf("Primary Misses:\t\t%u\n", m->primary_misses);
+    printf("Merged Misses:\t\t%u\n", m->merged_misses);
+    printf("MSHR Full Stalls:\t%u (%lu cycles)\n", m->full_stalls, m->stall_cycles);
+    printf("Avg MLP:\t\t%.2lf\n",
+           m->busy_cycles ? (double) m->outstanding_area / m->busy_cycles : 0);
+    printf("Total Cycles:\t\t%lu (blocking: %lu)\n", m->cycle, blocking);
+    printf("*******************************************\n");
+}
+
+/**
+ * Free memory allocated to MSHR file
+ * @param m: pointer to MSHR file
+ */
+void mshr_free(mshr_file* m)
+{
+    free(m->entries);
+    free(m);
+}
@@ -0,0 +1,42 @@
+#ifndef MSHR_H
+#define MSHR_H
+
+#include <stdint.h>
+
+#define MSHR_DEFAULT_LATENCY 100
+
+typedef struct mshr_entry
+{
+    uint32_t block;
+    unsigned long ready;
+} mshr_entry;
+
+typedef struct mshr_file
+{
+    int num_entries;
+    int in_use;
+    mshr_entry* entries;
+    unsigned int miss_latency;
+    unsigned long cycle;
+
+    unsigned int accesses;
+    unsigned int misses;
+    unsigned int primary_misses;
+    unsigned int merged_misses;
+    unsigned int full_stalls;
+    unsigned long stall_cycles;
+    unsigned long outstanding_area;
+    unsigned long busy_cycles;
+} mshr_file;
+
+mshr_file* mshr_init(int num_entries, unsigned int miss_latency);
+
+unsigned long mshr_access(mshr_file* m, void* addr, int was_miss);
+
+void mshr_finish(mshr_file* m);
+
+void mshr_print(mshr_file* m);
+
+void mshr_free(mshr_file* m);
+
+#endif
@@ -0,0 +1,235 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "sampling.h"
+
+/**
+ * Mix bits of x so that any subset of the result is uniformly distributed
+ * (finalizer of MurmurHash3)
+ * @param x: value to hash
+ * @return hashed value
+ */
+uint32_t sampling_hash(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x85ebca6b;
+    x ^= x >> 13;
+    x *= 0xc2b2ae35;
+    x ^= x >> 16;
+    return x;
+}
+
+/**
+ * Select a hashed subset of sets to simulate
+ * @param num_sets: number of sets in the cache
+ * @param rate: fraction of sets to simulate, in (0, 1]
+ * @return initialized sampler, with at least one sampled set
+ */
+set_sampler* ss_init(int num_sets, double rate)
+{
+    set_sampler* result = malloc(sizeof(set_sampler));
+    result->num_sets = num_sets;
+    result->num_sampled = 0;
+    result->skipped = 0;
+    result->is_sampled = malloc(num_sets * sizeof(int));
+    result->queries = calloc(num_sets, sizeof(unsigned int));
+    result->misses = calloc(num_sets, sizeof(unsigned int));
+
+    uint32_t threshold = (uint32_t) (rate * SAMPLING_MODULUS);
+    int best_set = 0;
+    for (int i = 0; i < num_sets; i++)
+    {
+        uint32_t h = sampling_hash(i) % SAMPLING_MODULUS;
+        result->is_sampled[i] = h < threshold;
+        result->num_sampled += result->is_sampled[i];
+        if (h < sampling_hash(best_set) % SAMPLING_MODULUS)
+            best_set = i;
+    }
+
+    // Tiny caches and rates may select nothing; keep the set hashing lowest
+    if (result->num_sampled == 0)
+    {
+        result->is_sampled[best_set] = 1;
+        result->num_sampled = 1;
+    }
+    return result;
+}
+
+/**
+ * Check whether accesses to a set are simulated
+ * @param ss: pointer to sampler
+ * @param set_index: set the access maps to
+ * @return 1 if the set is sampled, 0 otherwise (and the access is counted as skipped)
+ */
+int ss_is_sampled(set_sampler* ss, int set_index)
+{
+    if (ss->is_sampled[set_index])
+        return 1;
+    ss->skipped++;
+    return 0;
+}
+
+/**
+ * Record outcome of a simulated access for per-set confidence estimation
+ * @param ss: pointer to sampler
+ * @param set_index: set the access mapped to
+ * @param was_miss: 1 if the access missed
+ */
+void ss_record(set_sampler* ss, int set_index, int was_miss)
+{
+    ss->queries[set_index]++;
+    ss->misses[set_index] += was_miss;
+}
+
+/**
+ * Print whole-cache estimates scaled up from the sampled sets
+ * The hit rate is a ratio estimator over sampled sets; its confidence interval
+ * uses the between-set variance with a finite population correction
+ * @param ss: pointer to sampler
+ * @param mm: main memory (traffic counters are scaled like the cache counters)
+ */
+void ss_print(set_sampler* ss, main_memory* mm)
+{
+    double scale = (double) ss->num_sets / ss->num_sampled;
+    double queries = 0, misses = 0;
+    for (int i = 0; i < ss->num_sets; i++)
+    {
+        queries += ss->queries[i];
+        misses += ss->misses[i];
+    }
+
+    double miss_ratio = queries > 0 ? misses / queries : 0;
+    double half_width = 0;
+    if (ss->num_sampled > 1 && queries > 0)
+    {
+        double mean_queries = queries / ss->num_sampled;
+        double residuals = 0;
+        for (int i = 0; i < ss->num_sets; i++)
+        {
+            if (!ss->is_sampled[i])
+                continue;
+            double r = ss->misses[i] - miss_ratio * ss->queries[i];
+            residuals += r * r;
+        }
+        double fpc = 1.0 - (double) ss->num_sampled / ss->num_sets;
+        double variance = fpc * residuals / (ss->num_sampled - 1)
+                          / (ss->num_sampled * mean_queries * mean_queries);
+        half_width = SAMPLING_Z * sqrt(variance);
+    }
+
+    printf("Sampled Sets:\t\t%d/%d (%u accesses skipped)\n",
+           ss->num_sampled, ss->num_sets, ss->skipped);
+    printf("Est. Total Queries:\t%.0lf\n", queries * scale);
+    printf("Est. Total Hit Rate:\t%.2lf%% (+/- %.2lf%%)\n",
+           (1 - miss_ratio) * 100, half_width * 100);
+    printf("Est. Writes to MM:\t%.0lf\n", mm->w_queries * scale);
+    printf("Est. Reads from MM:\t%.0lf\n", mm->r_queries * scale);
+    printf("*******************************************\n");
+}
+
+/**
+ * Free memory allocated to sampler
+ * @param ss: pointer to sampler
+ */
+void ss_free(set_sampler* ss)
+{
+    free(ss->is_sampled);
+    free(ss->queries);
+    free(ss->misses);
+    free(ss);
+}
+
+/**
+ * Allocate a SHARDS-style spatial sampler: a block is tracked iff its hashed
+ * block number falls below rate * SAMPLING_MODULUS, so all references to a
+ * sampled block are seen and reuse distances among sampled blocks are exact
+ * @param rate: fraction of blocks to sample, in (0, 1]
+ * @return initialized sampler
+ */
+shards_sampler* shards_init(double rate)
+{
+    shards_sampler* result = malloc(sizeof(shards_sampler));
+    result->threshold = (uint32_t) (rate * SAMPLING_MODULUS);
+    result->rate = (double) result->threshold / SAMPLING_MODULUS;
+    result->total_refs = 0;
+    result->sampled_refs = 0;
+    result->cold_misses = 0;
+    result->stack_size = 0;
+    result->stack = malloc(SHARDS_MAX_BLOCKS * sizeof(uint32_t));
+    result->histogram = calloc(SHARDS_MAX_BLOCKS, sizeof(unsigned int));
+    return result;
+}
+
+/**
+ * Feed one reference to the sampler, updating the LRU stack of sampled blocks
+ * @param sh: pointer to sampler
+ * @param addr: accessed address
+ */
+void shards_access(shards_sampler* sh, void* addr)
+{
+    sh->total_refs++;
+    uint32_t block = (uint32_t) (uintptr_t) addr >> MAIN_MEMORY_BLOCK_SIZE_LN;
+    if (sampling_hash(block) % SAMPLING_MODULUS >= sh->threshold)
+        return;
+    sh->sampled_refs++;
+
+    // Position in the stack is the reuse distance among sampled blocks
+    int distance = 0;
+    while (distance < sh->stack_size && sh->stack[distance] != block)
+        distance++;
+
+    if (distance == sh->stack_size)
+    {
+        sh->cold_misses++;
+        sh->stack_size++;
+    }
+    else
+        sh->histogram[distance]++;
+
+    memmove(sh->stack + 1, sh->stack, distance * sizeof(uint32_t));
+    sh->stack[0] = block;
+}
+
+/**
+ * Print the estimated LRU miss-ratio curve for power-of-two cache sizes
+ * A reuse distance d among sampled blocks corresponds to d / rate blocks
+ * @param sh: pointer to sampler
+ */
+void shards_print(shards_sampler* sh)
+{
+    printf("SHARDS Sampled Refs:\t%u/%u (rate %.4lf)\n",
+           sh->sampled_refs, sh->total_refs, sh->rate);
+    if (sh->sampled_refs == 0)
+    {
+        printf("*******************************************\n");
+        return;
+    }
+
+    printf("Blocks\tMiss Ratio\n");
+    unsigned int hits = 0;
+    int distance = 0;
+    for (int blocks = 1; blocks <= SHARDS_MAX_BLOCKS; blocks *= 2)
+    {
+        while (distance < SHARDS_MAX_BLOCKS && distance / sh->rate < blocks)
+            hits += sh->histogram[distance++];
+
+        double miss_ratio = 1.0 - (double) hits / sh->sampled_refs;
+        double half_width = SAMPLING_Z
+                            * sqrt(miss_ratio * (1 - miss_ratio) / sh->sampled_refs);
+        printf("%d\t%.4lf (+/- %.4lf)\n", blocks, miss_ratio, half_width);
+    }
+    printf("*******************************************\n");
+}
+
+/**
+ * Free memory allocated to sampler
+ * @param sh: pointer to sampler
+ */
+void shards_free(shards_sampler* sh)
+{
+    free(sh->stack);
+    free(sh->histogram);
+    free(sh);
+}
@@ -0,0 +1,55 @@
+#ifndef SAMPLING_H
+#define SAMPLING_H
+
+#include <stdint.h>
+
+#include "main_memory.h"
+#include "cache_stats.h"
+
+#define SAMPLING_MODULUS (1 << 24)
+#define SAMPLING_Z 1.96
+#define SHARDS_MAX_BLOCKS (MAIN_MEMORY_SIZE >> MAIN_MEMORY_BLOCK_SIZE_LN)
+
+typedef struct set_sampler
+{
+    int num_sets;
+    int num_sampled;
+    int* is_sampled;
+    unsigned int* queries;
+    unsigned int* misses;
+    unsigned int skipped;
+} set_sampler;
+
+typedef struct shards_sampler
+{
+    uint32_t threshold;
+    double rate;
+    unsigned int total_refs;
+    unsigned int sampled_refs;
+    unsigned int cold_misses;
+    int stack_size;
+    uint32_t* stack;
+    unsigned int* histogram;
+} shards_sampler;
+
+uint32_t sampling_hash(uint32_t x);
+
+set_sampler* ss_init(int num_sets, double rate);
+
+int ss_is_sampled(set_sampler* ss, int set_index);
+
+void ss_record(set_sampler* ss, int set_index, int was_miss);
+
+void ss_print(set_sampler* ss, main_memory* mm);
+
+void ss_free(set_sampler* ss);
+
+shards_sampler* shards_init(double rate);
+
+void shards_access(shards_sampler* sh, void* addr);
+
+void shards_print(shards_sampler* sh);
+
+void shards_free(shards_sampler* sh);
+
+#endif
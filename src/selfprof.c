@@ -0,0 +1,197 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#include "selfprof.h"
+
+static const uint64_t configs[SP_NUM_COUNTERS] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+};
+
+static uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/**
+ * Open one user-space hardware counter, as a member of group_fd's group
+ * @return file descriptor, -1 if unavailable
+ */
+static int open_counter(uint64_t config, int group_fd)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = config;
+    attr.disabled = group_fd == -1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+}
+
+/**
+ * Read all open counters of the group
+ * @param sp: profiler
+ * @param out: counter values, indexed by SP_* counter; unopened ones are 0
+ */
+static void read_counters(selfprof* sp, uint64_t* out)
+{
+    uint64_t buf[1 + SP_NUM_COUNTERS];
+    memset(out, 0, SP_NUM_COUNTERS * sizeof(uint64_t));
+    if (sp->num_open == 0
+        || read(sp->group_fd, buf, (1 + sp->num_open) * sizeof(uint64_t)) <= 0)
+        return;
+    for (int i = 0; i < SP_NUM_COUNTERS; i++)
+        if (sp->slot[i] != -1)
+            out[i] = buf[1 + sp->slot[i]];
+}
+
+/**
+ * Estimate what a phase switch itself costs, so it can be subtracted
+ * @param sp: profiler
+ */
+static void calibrate(selfprof* sp)
+{
+    uint64_t a[SP_NUM_COUNTERS], b[SP_NUM_COUNTERS];
+    for (int i = 0; i < SP_NUM_COUNTERS; i++)
+        sp->overhead[i] = UINT64_MAX;
+    sp->overhead_ns = UINT64_MAX;
+
+    for (int r = 0; r < SP_CALIBRATION_ROUNDS; r++)
+    {
+        uint64_t t0 = now_ns();
+        read_counters(sp, a);
+        uint64_t t1 = now_ns();
+        read_counters(sp, b);
+        for (int i = 0; i < SP_NUM_COUNTERS; i++)
+            if (b[i] - a[i] < sp->overhead[i])
+                sp->overhead[i] = b[i] - a[i];
+        if (t1 - t0 < sp->overhead_ns)
+            sp->overhead_ns = t1 - t0;
+    }
+}
+
+/**
+ * Open cycle, instruction, cache miss and branch miss counters for this
+ * process. Counters the kernel refuses (e.g. in containers) are reported
+ * as unavailable; wall clock time is always measured
+ * @return profiler, currently in phase SP_OTHER
+ */
+selfprof* sp_init()
+{
+    selfprof* result = calloc(1, sizeof(selfprof));
+    result->group_fd = -1;
+    for (int i = 0; i < SP_NUM_COUNTERS; i++)
+    {
+        result->slot[i] = -1;
+        result->fds[i] = open_counter(configs[i], result->group_fd);
+        if (result->fds[i] == -1)
+            continue;
+        if (result->group_fd == -1)
+            result->group_fd = result->fds[i];
+        result->slot[i] = result->num_open++;
+    }
+
+    if (result->num_open == 0)
+        fprintf(stderr, "Warning: perf_event_open unavailable, profiling wall clock time only.\n");
+    else
+    {
+        ioctl(result->group_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(result->group_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    calibrate(result);
+    result->phase = SP_OTHER;
+    read_counters(result, result->last);
+    result->last_ns = now_ns();
+    return result;
+}
+
+/**
+ * Charge everything since the previous switch to the current phase, less
+ * the calibrated cost of a switch, and enter a new phase. Every switch into
+ * SP_LOOKUP starts a new simulated access
+ * @param sp: profiler
+ * @param phase: SP_* phase being entered
+ */
+void sp_switch(selfprof* sp, int phase)
+{
+    uint64_t cur[SP_NUM_COUNTERS];
+    uint64_t t = now_ns();
+    read_counters(sp, cur);
+
+    for (int i = 0; i < SP_NUM_COUNTERS; i++)
+    {
+        uint64_t delta = cur[i] - sp->last[i];
+        sp->totals[sp->phase][i] += delta > sp->overhead[i] ? delta - sp->overhead[i] : 0;
+        sp->last[i] = cur[i];
+    }
+    uint64_t delta_ns = t - sp->last_ns;
+    sp->ns[sp->phase] += delta_ns > sp->overhead_ns ? delta_ns - sp->overhead_ns : 0;
+    sp->last_ns = t;
+
+    sp->switches[phase]++;
+    if (phase == SP_LOOKUP)
+        sp->accesses++;
+    sp->phase = phase;
+}
+
+/**
+ * Print per-access cost of every phase
+ * @param sp: profiler
+ */
+void sp_print(selfprof* sp)
+{
+    static const char* phases[] = { "parse", "lookup", "fill", "update", "other" };
+    static const char* counters[] = { "cycles", "instr", "llc-miss", "br-miss" };
+    double n = sp->accesses ? sp->accesses : 1;
+
+    sp_switch(sp, SP_OTHER);
+    printf("Profiled Records:\t%lu\n", (unsigned long) sp->accesses);
+    printf("Phase\tns");
+    for (int i = 0; i < SP_NUM_COUNTERS; i++)
+        printf("\t%s", counters[i]);
+    printf("\tIPC\n");
+    for (int p = 0; p < SP_NUM_PHASES; p++)
+    {
+        printf("%s\t%.1lf", phases[p], sp->ns[p] / n);
+        for (int i = 0; i < SP_NUM_COUNTERS; i++)
+        {
+            if (sp->slot[i] == -1)
+                printf("\tn/a");
+            else
+                printf("\t%.2lf", sp->totals[p][i] / n);
+        }
+        if (sp->slot[SP_CYCLES] != -1 && sp->slot[SP_INSTRUCTIONS] != -1
+            && sp->totals[p][SP_CYCLES] > 0)
+            printf("\t%.2lf\n",
+                   (double) sp->totals[p][SP_INSTRUCTIONS] / sp->totals[p][SP_CYCLES]);
+        else
+            printf("\tn/a\n");
+    }
+    printf("Switch Overhead:\t%lu ns (subtracted)\n", (unsigned long) sp->overhead_ns);
+    printf("*******************************************\n");
+}
+
+/**
+ * Close counters and free profiler
+ * @param sp: profiler
+ */
+void sp_free(selfprof* sp)
+{
+    for (int i = 0; i < SP_NUM_COUNTERS; i++)
+        if (sp->fds[i] != -1)
+            close(sp->fds[i]);
+    free(sp);
+}
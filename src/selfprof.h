@@ -0,0 +1,49 @@
+#ifndef SELFPROF_H
+#define SELFPROF_H
+
+#include <stdint.h>
+
+#define SP_PARSE 0
+#define SP_LOOKUP 1
+#define SP_FILL 2
+#define SP_UPDATE 3
+#define SP_OTHER 4
+#define SP_NUM_PHASES 5
+
+#define SP_CYCLES 0
+#define SP_INSTRUCTIONS 1
+#define SP_CACHE_MISSES 2
+#define SP_BRANCH_MISSES 3
+#define SP_NUM_COUNTERS 4
+
+// Back-to-back reads used to estimate the cost of one phase switch
+#define SP_CALIBRATION_ROUNDS 1000
+
+typedef struct selfprof
+{
+    int group_fd;
+    int fds[SP_NUM_COUNTERS];
+    int slot[SP_NUM_COUNTERS];
+    int num_open;
+
+    int phase;
+    uint64_t last[SP_NUM_COUNTERS];
+    uint64_t last_ns;
+    uint64_t overhead[SP_NUM_COUNTERS];
+    uint64_t overhead_ns;
+
+    uint64_t totals[SP_NUM_PHASES][SP_NUM_COUNTERS];
+    uint64_t ns[SP_NUM_PHASES];
+    uint64_t switches[SP_NUM_PHASES];
+    uint64_t accesses;
+} selfprof;
+
+selfprof* sp_init();
+
+void sp_switch(selfprof* sp, int phase);
+
+void sp_print(selfprof* sp);
+
+void sp_free(selfprof* sp);
+
+#endif
@@ -0,0 +1,343 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "server.h"
+#include "trace_reader.h"
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void request_stop(int sig)
+{
+    (void) sig;
+    stop_requested = 1;
+}
+
+/**
+ * Create a cache with its own main memory, quiet like -q
+ * @param mode: MODE_* cache type
+ * @param mm_path: memory image, NULL for mm_init.data
+ * @param huge_pages: 1 to move the memory image to huge pages
+ * @return instance
+ */
+static sim_instance* instance_init(int mode, const char* mm_path, int huge_pages)
+{
+    sim_instance* result = calloc(1, sizeof(sim_instance));
+    result->mm = mm_init(mm_path);
+    result->mm->verbose = 0;
+    if (huge_pages)
+        mm_use_huge_pages(result->mm);
+    result->c = cache_init(mode, result->mm);
+    return result;
+}
+
+static void instance_free(sim_instance* sim)
+{
+    cache_free(sim->c);
+    mm_free(sim->mm);
+    free(sim);
+}
+
+/**
+ * Simulate records in place in the receive buffer
+ * @param sim: instance the records belong to
+ * @param records: first record
+ * @param n: number of records
+ */
+static void simulate_records(sim_instance* sim, trace_record* records, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+    {
+        trace_record* r = &records[i];
+
+        if (r->op > TRACE_OP_FLUSH)
+        {
+            sim->rejected++;
+            continue;
+        }
+        if (sim->c->mode == MODE_SAC)
+            sim->c->sac->tenant = r->tenant < SET_ASSOCIATIVE_MAX_TENANTS ? r->tenant : 0;
+
+        cache_access(sim->c, TRACE_OP_CHARS[r->op], tr_fold_addr(r->addr), r->val);
+    }
+    sim->records += n;
+}
+
+/**
+ * Send as much queued output as the socket takes without blocking
+ * @param client: connection
+ * @return 0 to keep the connection, -1 if the client is gone
+ */
+static int client_flush(server_client* client)
+{
+    while (client->out_used > 0)
+    {
+        ssize_t n = send(client->fd, client->out, client->out_used, MSG_NOSIGNAL);
+        if (n == -1 && errno == EINTR)
+            continue;
+        if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return 0;
+        if (n <= 0)
+            return -1;
+        memmove(client->out, client->out + n, client->out_used - n);
+        client->out_used -= n;
+    }
+    return 0;
+}
+
+/**
+ * Append to a client's output; the rest is sent when the socket has room
+ * @return 0 on success, -1 if the client is too far behind reading replies
+ */
+static int queue_output(server_client* client, const void* data, size_t size)
+{
+    if (client->out_used + size > SERVER_OUT_SIZE)
+    {
+        fprintf(stderr, "Warning: Client is not reading its replies, closing client.\n");
+        return -1;
+    }
+    memcpy(client->out + client->out_used, data, size);
+    client->out_used += size;
+    return 0;
+}
+
+static int send_stats(server_client* client)
+{
+    trace_msg_header header = { TRACE_MSG_STATS, 1 };
+    trace_stats_reply reply;
+    memset(&reply, 0, sizeof(reply));
+    reply.records = client->sim->records;
+    reply.rejected = client->sim->rejected;
+    reply.cs = *cache_get_stats(client->sim->c);
+    reply.mm_w_queries = client->sim->mm->w_queries;
+    reply.mm_r_queries = client->sim->mm->r_queries;
+    reply.mm_w_bytes = client->sim->mm->w_bytes;
+    reply.mm_r_bytes = client->sim->mm->r_bytes;
+    if (queue_output(client, &header, sizeof(header)) == -1
+        || queue_output(client, &reply, sizeof(reply)) == -1)
+        return -1;
+    return client_flush(client);
+}
+
+/**
+ * Consume complete messages from the start of a client's buffer; batch
+ * records are simulated where they were received, only a trailing partial
+ * header or record is moved to the front
+ * @param client: connection
+ * @return 0 to keep the connection, -1 to close it
+ */
+static int process_buffer(server_client* client)
+{
+    size_t pos = 0;
+    while (pos < client->used)
+    {
+        size_t avail = client->used - pos;
+        if (client->remaining == 0)
+        {
+            if (avail < sizeof(trace_msg_header))
+                break;
+            trace_msg_header header;
+            memcpy(&header, client->buffer + pos, sizeof(header));
+            pos += sizeof(header);
+            if (header.type == TRACE_MSG_BATCH)
+                client->remaining = header.count;
+            else if (header.type == TRACE_MSG_STATS)
+            {
+                if (send_stats(client) == -1)
+                    return -1;
+            }
+            else
+            {
+                fprintf(stderr, "Warning: Unknown message type %u, closing client.\n", header.type);
+                return -1;
+            }
+            continue;
+        }
+
+        size_t n = avail / sizeof(trace_record);
+        if (n == 0)
+            break;
+        if (n > client->remaining)
+            n = client->remaining;
+
+        // Headers and records are multiples of the record alignment, so pos stays aligned
+        simulate_records(client->sim, (trace_record*) (client->buffer + pos), n);
+        pos += n * sizeof(trace_record);
+        client->remaining -= n;
+    }
+
+    memmove(client->buffer, client->buffer + pos, client->used - pos);
+    client->used -= pos;
+    return 0;
+}
+
+/**
+ * Read everything available on a client socket
+ * @param client: connection
+ * @return 0 to keep the connection, -1 to close it
+ */
+static int client_readable(server_client* client)
+{
+    for (;;)
+    {
+        ssize_t n = recv(client->fd, client->buffer + client->used,
+                         SERVER_BUFFER_SIZE - client->used, 0);
+        if (n == 0)
+            return -1;
+        if (n == -1)
+            return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : -1;
+        client->used += n;
+        if (process_buffer(client) == -1)
+            return -1;
+    }
+}
+
+/**
+ * Watch a client for EPOLLOUT exactly while it has output queued
+ * @param epoll_fd: epoll instance of the server
+ * @param client: connection
+ */
+static void client_watch(int epoll_fd, server_client* client)
+{
+    int writing = client->out_used > 0;
+    if (writing == client->writing)
+        return;
+    client->writing = writing;
+    struct epoll_event ev = { .events = EPOLLIN | EPOLLRDHUP | (writing ? EPOLLOUT : 0), .data.ptr = client };
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, client->fd, &ev);
+}
+
+/**
+ * Close a client connection and unlink it from the connected clients
+ * @param clients: first connected client
+ * @param client: client to close
+ * @param shared: 1 if client->sim is the shared instance
+ */
+static void client_close(server_client** clients, server_client* client, int shared)
+{
+    if (client->prev)
+        client->prev->next = client->next;
+    else
+        *clients = client->next;
+    if (client->next)
+        client->next->prev = client->prev;
+    close(client->fd);
+    if (!shared)
+        instance_free(client->sim);
+    free(client->buffer);
+    free(client);
+}
+
+/**
+ * Serve simulation clients on a Unix domain socket until SIGINT or SIGTERM
+ * Each connection streams TRACE_MSG_BATCH messages and may ask for
+ * TRACE_MSG_STATS at any point
+ * @param mode: MODE_* cache type for every instance
+ * @param path: socket path, replaced if it exists
+ * @param shared: 1 to feed all clients into one cache, 0 for one cache each
+ * @param mm_path: memory image of every instance, NULL for mm_init.data
+ * @param huge_pages: 1 to back memory images and cache lines with huge pages
+ * @return exit status
+ */
+int server_run(int mode, const char* path, int shared, const char* mm_path, int huge_pages)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "Error: Socket path %s is too long.\n", path);
+        return 2;
+    }
+    strcpy(addr.sun_path, path);
+
+    // Load the image before listening, so a missing or short one fails here
+    // rather than exiting the server when a client connects
+    main_memory* image = mm_init(mm_path);
+    if (huge_pages)
+    {
+        mb_use_huge_pages(1);
+        if (!mm_use_huge_pages(image))
+            fprintf(stderr, "Warning: No hugetlb pages reserved, using transparent huge pages.\n");
+    }
+    mm_free(image);
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    unlink(path);
+    if (listen_fd == -1 || bind(listen_fd, (struct sockaddr*) &addr, sizeof(addr)) == -1
+        || listen(listen_fd, SERVER_BACKLOG) == -1)
+    {
+        fprintf(stderr, "Error: Could not listen on %s.\n", path);
+        return 3;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = request_stop;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev);
+
+    sim_instance* shared_sim = shared ? instance_init(mode, mm_path, huge_pages) : NULL;
+    server_client* clients = NULL;
+    unsigned int num_clients = 0;
+    struct epoll_event events[SERVER_MAX_EVENTS];
+    printf("Serving on %s (%s cache)\n", path, shared ? "shared" : "per-client");
+    fflush(stdout);
+
+    while (!stop_requested)
+    {
+        int n = epoll_wait(epoll_fd, events, SERVER_MAX_EVENTS, -1);
+        for (int i = 0; i < n; i++)
+        {
+            server_client* client = events[i].data.ptr;
+            if (client == NULL)
+            {
+                int fd;
+                while ((fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1)
+                {
+                    client = calloc(1, sizeof(server_client));
+                    client->fd = fd;
+                    client->sim = shared ? shared_sim : instance_init(mode, mm_path, huge_pages);
+                    client->buffer = aligned_alloc(_Alignof(trace_record), SERVER_BUFFER_SIZE);
+                    client->next = clients;
+                    if (clients)
+                        clients->prev = client;
+                    clients = client;
+                    struct epoll_event cev = { .events = EPOLLIN | EPOLLRDHUP, .data.ptr = client };
+                    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &cev);
+                    num_clients++;
+                }
+                continue;
+            }
+            if (client_flush(client) == -1 || client_readable(client) == -1)
+            {
+                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, client->fd, NULL);
+                client_close(&clients, client, shared);
+            }
+            else
+                client_watch(epoll_fd, client);
+        }
+    }
+
+    printf("Served %u clients\n", num_clients);
+    while (clients)
+        client_close(&clients, clients, shared);
+    if (shared_sim)
+        instance_free(shared_sim);
+    close(epoll_fd);
+    close(listen_fd);
+    unlink(path);
+    return 0;
+}
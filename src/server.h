@@ -0,0 +1,43 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "cache.h"
+#include "trace_record.h"
+
+// Receive buffer per connection, a whole number of records
+#define SERVER_BUFFER_RECORDS 8192
+#define SERVER_BUFFER_SIZE (SERVER_BUFFER_RECORDS * sizeof(trace_record))
+// Stats replies queued for a client that is slow to read them; a client
+// that falls further behind is closed
+#define SERVER_OUT_REPLIES 64
+#define SERVER_OUT_SIZE (SERVER_OUT_REPLIES * (sizeof(trace_msg_header) + sizeof(trace_stats_reply)))
+#define SERVER_MAX_EVENTS 64
+#define SERVER_BACKLOG 16
+
+typedef struct sim_instance
+{
+    main_memory* mm;
+    cache* c;
+    uint64_t records;
+    uint64_t rejected;
+} sim_instance;
+
+typedef struct server_client
+{
+    int fd;
+    sim_instance* sim;
+    unsigned char* buffer;
+    size_t used;
+    uint32_t remaining;
+    // Replies not yet taken by the socket; writing when EPOLLOUT is watched
+    unsigned char out[SERVER_OUT_SIZE];
+    size_t out_used;
+    int writing;
+    // Connected clients, so those still open at shutdown can be released
+    struct server_client* prev;
+    struct server_client* next;
+} server_client;
+
+int server_run(int mode, const char* path, int shared, const char* mm_path, int huge_pages);
+
+#endif
@@ -4,8 +4,6 @@
 #include "memory_block.h"
 #include "set_associative.h"
 
-#define NEARING_OVERFLOW 2147483640
-
 /**
  * Allocate memory and initialize cache
  * @param mm: main memory
@@ -17,16 +15,38 @@ set_associative_cache* sac_init(main_memory* mm)
     result->mm = mm;
     result->cs = cs_init();
     result->cache_set = malloc(SET_ASSOCIATIVE_NUM_SETS * sizeof(sac_map_set));
+    result->sectored = 0;
+    result->tenant = 0;
+    result->partitioned = 0;
+    result->ucp = NULL;
+    result->index_fn = INDEX_MODULO;
+    result->set_hist = calloc(SET_ASSOCIATIVE_NUM_SETS, sizeof(set_stats));
+    result->num_tags = SET_ASSOCIATIVE_NUM_WAYS;
+    result->comp = NULL;
+    result->prof = NULL;
+    result->hot = NULL;
+    result->non_temporal = 0;
+    result->nt_policy = NT_INSERT_LRU;
+    for (int t = 0; t < SET_ASSOCIATIVE_MAX_TENANTS; t++)
+    {
+        result->way_mask[t] = (1u << SET_ASSOCIATIVE_NUM_WAYS) - 1;
+        result->tenant_cs[t] = cs_init();
+    }
     for (int i = 0; i < SET_ASSOCIATIVE_NUM_SETS; i++)
     {
         result->cache_set[i].num_ways = 0;
-        result->cache_set[i].usage = malloc(SET_ASSOCIATIVE_NUM_WAYS * sizeof(int));
-        result->cache_set[i].ways = malloc(SET_ASSOCIATIVE_NUM_WAYS * sizeof(sac_map_way));
+        result->cache_set[i].usage = malloc(SET_ASSOCIATIVE_MAX_TAGS * sizeof(int));
+        result->cache_set[i].ways = malloc(SET_ASSOCIATIVE_MAX_TAGS * sizeof(sac_map_way));
 
-        for(int j = 0; j < SET_ASSOCIATIVE_NUM_WAYS; j++)
+        // Tags beyond SET_ASSOCIATIVE_NUM_WAYS are only used by compressed caches
+        for(int j = 0; j < SET_ASSOCIATIVE_MAX_TAGS; j++)
         {
             result->cache_set[i].ways[j].is_valid = 0;
             result->cache_set[i].ways[j].is_dirty = 0;
+            result->cache_set[i].ways[j].valid_mask = 0;
+            result->cache_set[i].ways[j].dirty_mask = 0;
+            result->cache_set[i].ways[j].comp_size = MAIN_MEMORY_BLOCK_SIZE;
+            result->cache_set[i].ways[j].comp_encoding = COMPRESSION_NONE;
 
             // Initialize data with dummy values
             result->cache_set[i].ways[j].mem_block = malloc(sizeof(memory_block));
@@ -40,13 +60,27 @@ set_associative_cache* sac_init(main_memory* mm)
 
 /**
  * Compute index corresponding to block number
+ * @param sac: pointer to cache
  * @param addr: full address
+ * @param way: way being indexed (only matters for skewed indexing)
  * @return int index corresponding to block number
  */
-static int addr_to_set(void* addr)
+static int addr_to_set(set_associative_cache* sac, void* addr, int way)
 {
     unsigned int result = (unsigned int) (uintptr_t) addr;
-    return (result >> MAIN_MEMORY_BLOCK_SIZE_LN) & ((1 << SET_ASSOCIATIVE_NUM_SETS_LN) - 1);
+    return idx_block_to_set(sac->index_fn, result >> MAIN_MEMORY_BLOCK_SIZE_LN,
+                            SET_ASSOCIATIVE_NUM_SETS_LN, way);
+}
+
+/**
+ * Compute set index of addr, for callers outside the cache (e.g. set sampling)
+ * @param sac: pointer to cache
+ * @param addr: full address
+ * @return int index of the set addr maps to
+ */
+int sac_set_index(set_associative_cache* sac, void* addr)
+{
+    return addr_to_set(sac, addr, 0);
 }
 
 /**
@@ -61,6 +95,11 @@ static int lru(set_associative_cache* sac, int set_index)
     if (sac->cache_set[set_index].num_ways < SET_ASSOCIATIVE_NUM_WAYS)
         return sac->cache_set[set_index].num_ways++;
 
+    // Reuse a way freed by an invalidation before evicting
+    for (int i = 0; i < SET_ASSOCIATIVE_NUM_WAYS; i++)
+        if (sac->cache_set[set_index].ways[i].is_valid != 1)
+            return i;
+
     int max_index = 0;
     float max_value = sac->cache_set[set_index].usage[0];
 
@@ -75,6 +114,94 @@ static int lru(set_associative_cache* sac, int set_index)
     return max_index;
 }
 
+/**
+ * Find eviction candidate for the current tenant of a partitioned cache:
+ * an invalid way in the tenant's mask if any, otherwise the least recently used
+ * way in the mask. Tenants without ways never get here, their misses bypass
+ * @param sac: pointer to cache
+ * @param set_index: index of corresponding set
+ * @return integer way - corresponding to index of memory block to be evicted
+ */
+static int partition_victim(set_associative_cache* sac, int set_index)
+{
+    sac_map_set* set = &sac->cache_set[set_index];
+    unsigned int mask = sac->way_mask[sac->tenant];
+
+    int victim = -1;
+    for (int i = 0; i < SET_ASSOCIATIVE_NUM_WAYS; i++)
+    {
+        if (!(mask & (1u << i)))
+            continue;
+        if (set->ways[i].is_valid != 1)
+        {
+            victim = i;
+            break;
+        }
+        if (victim == -1 || set->usage[i] > set->usage[victim])
+            victim = i;
+    }
+
+    // Ways below num_ways are the ones scanned on lookup and usage updates
+    if (victim >= set->num_ways)
+        set->num_ways = victim + 1;
+    return victim;
+}
+
+/**
+ * Set way masks from the current UCP allocation, giving each tenant a
+ * contiguous range of ways
+ * @param sac: pointer to cache
+ */
+static void apply_allocation(set_associative_cache* sac)
+{
+    int first = 0;
+    for (int t = 0; t < SET_ASSOCIATIVE_MAX_TENANTS; t++)
+    {
+        sac->way_mask[t] = ((1u << sac->ucp->alloc[t]) - 1) << first;
+        first += sac->ucp->alloc[t];
+    }
+}
+
+/**
+ * Restrict the ways a tenant may allocate into; hits are allowed in any way
+ * @param sac: pointer to cache
+ * @param tenant: tenant id, smaller than SET_ASSOCIATIVE_MAX_TENANTS
+ * @param mask: bit i set if the tenant may replace way i
+ */
+void sac_set_way_mask(set_associative_cache* sac, int tenant, unsigned int mask)
+{
+    sac->partitioned = 1;
+    sac->way_mask[tenant] = mask & ((1u << SET_ASSOCIATIVE_NUM_WAYS) - 1);
+}
+
+/**
+ * Partition ways dynamically with utility-based cache partitioning (UCP)
+ * @param sac: pointer to cache
+ * @param interval: accesses between two repartitions
+ */
+void sac_enable_ucp(set_associative_cache* sac, unsigned int interval)
+{
+    sac->partitioned = 1;
+    sac->ucp = ucp_init(SET_ASSOCIATIVE_MAX_TENANTS, SET_ASSOCIATIVE_NUM_SETS,
+                        SET_ASSOCIATIVE_NUM_WAYS, interval);
+    apply_allocation(sac);
+}
+
+/**
+ * Per-tenant bookkeeping at the end of an access
+ * @param sac: pointer to cache
+ * @param set_index: set that was accessed
+ * @param mb_start_addr: start address of accessed memory block
+ */
+static void account_tenant(set_associative_cache* sac, int set_index, void* mb_start_addr)
+{
+    if (sac->ucp == NULL)
+        return;
+    uint32_t block = (uint32_t) (uintptr_t) mb_start_addr >> MAIN_MEMORY_BLOCK_SIZE_LN;
+    if (ucp_access(sac->ucp, sac->tenant, set_index, block))
+        apply_allocation(sac);
+}
+
 /**
  * Handle and eliminate potential LRU overflows
  * Change sac->usage values to smaller, scaled down quantities while maintaining relative usage order
@@ -91,27 +218,425 @@ static void normalize_usage_count(set_associative_cache* sac, int set_index)
 
 /**
  * Find way number in case of hit
+ * Tags are full block numbers, since hashed indexing does not keep the index bits
  * @param sac: pointer to cache
  * @param mb_start_addr: start address of required memory block
- * @param set_index: index of corresponding set for which lru is to be found
+ * @param set_index: index of corresponding set; for skewed indexing it is
+ *                   updated to the set of the way that hit
  * @return index (way number) if hit, -1 if miss
  */
-static int find_hit(set_associative_cache* sac, void* mb_start_addr, int set_index)
+static int find_hit(set_associative_cache* sac, void* mb_start_addr, int* set_index)
 {
     int mem_block_tag = (int) (uintptr_t) mb_start_addr;
-    mem_block_tag = mem_block_tag >> (MAIN_MEMORY_BLOCK_SIZE_LN + SET_ASSOCIATIVE_NUM_SETS_LN);
+    mem_block_tag = mem_block_tag >> MAIN_MEMORY_BLOCK_SIZE_LN;
+
+    // Each way of a skewed cache is looked up in its own set
+    if (sac->index_fn == INDEX_SKEWED)
+    {
+        for (int i = 0; i < SET_ASSOCIATIVE_NUM_WAYS; i++)
+        {
+            int set = addr_to_set(sac, mb_start_addr, i);
+            sac_map_way* way = &sac->cache_set[set].ways[i];
+            if (way->is_valid == 1
+                && ((int) (uintptr_t) way->mem_block->start_addr >> MAIN_MEMORY_BLOCK_SIZE_LN)
+                   == mem_block_tag)
+            {
+                *set_index = set;
+                return i;
+            }
+        }
+        return -1;
+    }
 
     // Compare tag against all memory blocks currently filled into ways
-    for (int i = 0; i < sac->cache_set[set_index].num_ways; i++)
+    for (int i = 0; i < sac->cache_set[*set_index].num_ways; i++)
     {
-        int current_addr = (int) (uintptr_t) sac->cache_set[set_index].ways[i].mem_block->start_addr;
-        int current_tag = current_addr >> (MAIN_MEMORY_BLOCK_SIZE_LN + SET_ASSOCIATIVE_NUM_SETS_LN);
-        if (sac->cache_set[set_index].ways[i].is_valid == 1 && current_tag == mem_block_tag)
+        int current_addr = (int) (uintptr_t) sac->cache_set[*set_index].ways[i].mem_block->start_addr;
+        int current_tag = current_addr >> MAIN_MEMORY_BLOCK_SIZE_LN;
+        if (sac->cache_set[*set_index].ways[i].is_valid == 1 && current_tag == mem_block_tag)
             return i;
     }
     return -1;
 }
 
+/**
+ * Find eviction candidate of a skewed cache among the block's set in every way:
+ * an invalid line if any, otherwise the least recently used candidate
+ * @param sac: pointer to cache
+ * @param mb_start_addr: start address of memory block to be filled
+ * @param set_index: updated to the set of the chosen way
+ * @return integer way - corresponding to index of memory block to be evicted
+ */
+static int skewed_victim(set_associative_cache* sac, void* mb_start_addr, int* set_index)
+{
+    int victim = -1;
+    for (int i = 0; i < SET_ASSOCIATIVE_NUM_WAYS; i++)
+    {
+        int set = addr_to_set(sac, mb_start_addr, i);
+        if (sac->cache_set[set].ways[i].is_valid != 1)
+        {
+            victim = i;
+            *set_index = set;
+            break;
+        }
+        if (victim == -1 || sac->cache_set[set].usage[i] > sac->cache_set[*set_index].usage[victim])
+        {
+            victim = i;
+            *set_index = set;
+        }
+    }
+
+    // Ways below num_ways are the ones scanned on usage updates and normalization
+    if (victim >= sac->cache_set[*set_index].num_ways)
+        sac->cache_set[*set_index].num_ways = victim + 1;
+    return victim;
+}
+
+/**
+ * Pick the way to fill on a miss according to the cache organization
+ * @param sac: pointer to cache
+ * @param mb_start_addr: start address of memory block to be filled
+ * @param set_index: index of corresponding set, updated for skewed indexing
+ * @return integer way - corresponding to index of memory block to be evicted
+ */
+static int choose_victim(set_associative_cache* sac, void* mb_start_addr, int* set_index)
+{
+    int result;
+    if (sac->index_fn == INDEX_SKEWED)
+        result = skewed_victim(sac, mb_start_addr, set_index);
+    else if (sac->partitioned)
+        result = partition_victim(sac, *set_index);
+    else
+        result = lru(sac, *set_index);
+
+    sac_map_way* way = &sac->cache_set[*set_index].ways[result];
+    if (way->is_valid == 1)
+    {
+        sac->set_hist[*set_index].evictions++;
+        if (sac->hot)
+            hot_evict(sac->hot, way->mem_block->start_addr, mb_start_addr);
+    }
+    return result;
+}
+
+/**
+ * Update LRU usage counts after an access to a way
+ * @param sac: pointer to cache
+ * @param mb_start_addr: start address of accessed memory block
+ * @param set_index: index of set that was accessed
+ * @param way_index: way that was accessed
+ */
+static void touch_way(set_associative_cache* sac, void* mb_start_addr, int set_index, int way_index)
+{
+    // Skewed sets share no LRU order; age the other candidate lines of the block instead
+    if (sac->index_fn == INDEX_SKEWED)
+    {
+        for (int i = 0; i < SET_ASSOCIATIVE_NUM_WAYS; i++)
+            if (i != way_index)
+                sac->cache_set[addr_to_set(sac, mb_start_addr, i)].usage[i]++;
+        sac->cache_set[set_index].usage[way_index] = 0;
+        return;
+    }
+
+    sac->cache_set[set_index].usage[way_index] = 0;
+    for (int i = 0; i < sac->cache_set[set_index].num_ways; i++)
+        if (i != way_index)
+            sac->cache_set[set_index].usage[i]++;
+}
+
+/**
+ * Place a non-temporal fill at the LRU position, so it is the next line evicted
+ * @param sac: pointer to cache
+ * @param mb_start_addr: start address of filled memory block
+ * @param set_index: index of set that was filled
+ * @param way_index: way that was filled
+ */
+static void insert_lru(set_associative_cache* sac, void* mb_start_addr, int set_index, int way_index)
+{
+    // Skewed ways compete with the block's candidate lines in the other ways' sets
+    int skewed = sac->index_fn == INDEX_SKEWED;
+    int num_ways = skewed ? SET_ASSOCIATIVE_NUM_WAYS : sac->cache_set[set_index].num_ways;
+    float max_value = 0;
+    for (int i = 0; i < num_ways; i++)
+    {
+        int set = skewed ? addr_to_set(sac, mb_start_addr, i) : set_index;
+        if (i != way_index && sac->cache_set[set].usage[i] > max_value)
+            max_value = sac->cache_set[set].usage[i];
+    }
+    sac->cache_set[set_index].usage[way_index] = max_value + 1;
+}
+
+/**
+ * Write memory block of a way back to main memory if valid and dirty
+ * Sectored caches only write back runs of dirty sectors
+ * @param sac: pointer to cache
+ * @param way: way about to be replaced
+ */
+static void write_back(set_associative_cache* sac, sac_map_way* way)
+{
+    if (way->is_valid != 1 || way->is_dirty != 1)
+        return;
+
+    if (!sac->sectored)
+    {
+        mm_write(sac->mm, way->mem_block->start_addr, way->mem_block);
+        return;
+    }
+
+    int i = 0;
+    while (i < SET_ASSOCIATIVE_NUM_SECTORS)
+    {
+        if (!(way->dirty_mask & (1u << i)))
+        {
+            i++;
+            continue;
+        }
+
+        int end = i;
+        while (end < SET_ASSOCIATIVE_NUM_SECTORS && (way->dirty_mask & (1u << end)))
+            end++;
+        mm_write_sector(sac->mm, way->mem_block->start_addr + i * SET_ASSOCIATIVE_SECTOR_SIZE,
+                        way->mem_block->data + i * SET_ASSOCIATIVE_SECTOR_SIZE,
+                        (end - i) * SET_ASSOCIATIVE_SECTOR_SIZE);
+        i = end;
+    }
+}
+
+/**
+ * Load sectors of a way that are not yet valid from main memory
+ * @param sac: pointer to cache
+ * @param way: way to fill
+ * @param mask: sectors to fetch, only those not already valid are read
+ */
+static void fill_sectors(set_associative_cache* sac, sac_map_way* way, unsigned int mask)
+{
+    mask &= ~way->valid_mask;
+    int i = 0;
+    while (i < SET_ASSOCIATIVE_NUM_SECTORS)
+    {
+        if (!(mask & (1u << i)))
+        {
+            i++;
+            continue;
+        }
+
+        int end = i;
+        while (end < SET_ASSOCIATIVE_NUM_SECTORS && (mask & (1u << end)))
+            end++;
+        mm_read_sector(sac->mm, way->mem_block->start_addr + i * SET_ASSOCIATIVE_SECTOR_SIZE,
+                       way->mem_block->data + i * SET_ASSOCIATIVE_SECTOR_SIZE,
+                       (end - i) * SET_ASSOCIATIVE_SECTOR_SIZE);
+        i = end;
+    }
+    way->valid_mask |= mask;
+}
+
+/**
+ * Check whether a miss must not allocate: a bypassing non-temporal access, or
+ * a tenant that currently owns no ways
+ * @param sac: pointer to cache
+ * @return 1 if the miss is served from main memory
+ */
+static int must_bypass(set_associative_cache* sac)
+{
+    return (sac->non_temporal && sac->nt_policy == NT_BYPASS)
+           || (sac->partitioned && sac->way_mask[sac->tenant] == 0);
+}
+
+/**
+ * Serve a miss from main memory without allocating, see must_bypass
+ * @param sac: pointer to cache
+ * @param set_index: index of the set the block maps to
+ * @param addr: address accessed
+ * @param mb_start_addr: start address of the block, for the UCP monitor
+ * @param val: data, for a store
+ * @param is_write: 1 for a store, 0 for a load
+ * @return value read, val for a store
+ */
+static unsigned int bypass(set_associative_cache* sac, int set_index, void* addr, void* mb_start_addr,
+                           unsigned int val, int is_write)
+{
+    if (is_write)
+    {
+        mm_write_sector(sac->mm, addr, &val, sizeof(val));
+        sac->cs.w_misses++;
+        sac->cs.w_queries++;
+        sac->tenant_cs[sac->tenant].w_misses++;
+        sac->tenant_cs[sac->tenant].w_queries++;
+    }
+    else
+    {
+        mm_read_sector(sac->mm, addr, &val, sizeof(val));
+        sac->cs.r_misses++;
+        sac->cs.r_queries++;
+        sac->tenant_cs[sac->tenant].r_misses++;
+        sac->tenant_cs[sac->tenant].r_queries++;
+    }
+    sac->set_hist[set_index].misses++;
+    sac->set_hist[set_index].queries++;
+
+    // A tenant without ways must stay visible to UCP to ever be given some
+    account_tenant(sac, set_index, mb_start_addr);
+    if ((sac->cs.w_queries + sac->cs.r_queries) % NEARING_OVERFLOW == 0)
+        normalize_usage_count(sac, set_index);
+    return val;
+}
+
+/**
+ * Replace memory block held by a way (after write back) with the block at mb_start_addr
+ * Sectored caches allocate the line without reading it; sectors are filled on demand
+ * @param sac: pointer to cache
+ * @param way: way to fill
+ * @param mb_start_addr: start address of new memory block
+ */
+static void fill_way(set_associative_cache* sac, sac_map_way* way, void* mb_start_addr)
+{
+    static unsigned char empty_block[MAIN_MEMORY_BLOCK_SIZE];
+    memory_block* mb;
+
+    if (sac->sectored)
+    {
+        mb = mb_new(mb_start_addr, MAIN_MEMORY_BLOCK_SIZE, empty_block);
+        way->valid_mask = 0;
+    }
+    else
+    {
+        // Load memory block from main memory
+        mb = mm_read(sac->mm, mb_start_addr);
+        way->valid_mask = SET_ASSOCIATIVE_FULL_MASK;
+    }
+    mb_free(way->mem_block);
+
+    way->mem_block = mb;
+    way->is_valid = 1;
+    way->is_dirty = 0;
+    way->dirty_mask = 0;
+}
+
+/**
+ * Store compressed lines: each set holds up to SET_ASSOCIATIVE_MAX_TAGS lines
+ * as long as their compressed sizes fit in SET_ASSOCIATIVE_SET_BYTES
+ * @param sac: pointer to cache
+ */
+void sac_enable_compression(set_associative_cache* sac)
+{
+    sac->num_tags = SET_ASSOCIATIVE_MAX_TAGS;
+    sac->comp = comp_stats_init(SET_ASSOCIATIVE_NUM_SETS, SET_ASSOCIATIVE_NUM_WAYS);
+
+    // Every tag is scanned on lookup; invalid ones are skipped by find_hit
+    for (int i = 0; i < SET_ASSOCIATIVE_NUM_SETS; i++)
+        sac->cache_set[i].num_ways = SET_ASSOCIATIVE_MAX_TAGS;
+}
+
+/**
+ * Evict least recently used lines of a compressed set until extra bytes fit
+ * @param sac: pointer to cache
+ * @param set_index: index of set
+ * @param extra: bytes about to be added to the set
+ * @param keep: way that must not be evicted, -1 if a free tag is needed too
+ * @param by: start address of the block that needs the room
+ * @return free way if keep is -1, otherwise -1
+ */
+static int make_room(set_associative_cache* sac, int set_index, int extra, int keep, void* by)
+{
+    sac_map_set* set = &sac->cache_set[set_index];
+    for (;;)
+    {
+        int used = 0, free_way = -1, victim = -1;
+        for (int i = 0; i < sac->num_tags; i++)
+        {
+            if (set->ways[i].is_valid != 1)
+            {
+                if (free_way == -1)
+                    free_way = i;
+                continue;
+            }
+            used += set->ways[i].comp_size;
+            if (i != keep && (victim == -1 || set->usage[i] > set->usage[victim]))
+                victim = i;
+        }
+
+        if (used + extra <= SET_ASSOCIATIVE_SET_BYTES && (keep != -1 || free_way != -1))
+            return keep == -1 ? free_way : -1;
+
+        write_back(sac, &set->ways[victim]);
+        set->ways[victim].is_valid = 0;
+        sac->set_hist[set_index].evictions++;
+        if (sac->hot)
+            hot_evict(sac->hot, set->ways[victim].mem_block->start_addr, by);
+        sac->comp->valid_lines--;
+    }
+}
+
+/**
+ * Fill a compressed set with the block at mb_start_addr, evicting as needed
+ * @param sac: pointer to cache
+ * @param set_index: index of set
+ * @param mb_start_addr: start address of memory block
+ * @return way the block was placed in
+ */
+static int compressed_fill(set_associative_cache* sac, int set_index, void* mb_start_addr)
+{
+    // The block must be read before its compressed size is known
+    memory_block* mb = mm_read(sac->mm, mb_start_addr);
+    int encoding;
+    int size = compress_size(mb->data, MAIN_MEMORY_BLOCK_SIZE, &encoding);
+    int way_index = make_room(sac, set_index, size, -1, mb_start_addr);
+    sac_map_way* way = &sac->cache_set[set_index].ways[way_index];
+
+    mb_free(way->mem_block);
+    way->mem_block = mb;
+    way->is_valid = 1;
+    way->is_dirty = 0;
+    way->valid_mask = SET_ASSOCIATIVE_FULL_MASK;
+    way->dirty_mask = 0;
+    way->comp_size = size;
+    way->comp_encoding = encoding;
+
+    sac->comp->fills++;
+    sac->comp->fill_bytes += size;
+    sac->comp->encodings[encoding]++;
+    sac->comp->valid_lines++;
+    return way_index;
+}
+
+/**
+ * Recompress a line after a store, evicting other lines if it grew
+ * @param sac: pointer to cache
+ * @param set_index: index of set
+ * @param way_index: way that was written
+ */
+static void recompress(set_associative_cache* sac, int set_index, int way_index)
+{
+    sac_map_way* way = &sac->cache_set[set_index].ways[way_index];
+    int encoding;
+    int size = compress_size(way->mem_block->data, MAIN_MEMORY_BLOCK_SIZE, &encoding);
+    if (size > way->comp_size)
+        make_room(sac, set_index, size - way->comp_size, way_index, way->mem_block->start_addr);
+    way->comp_size = size;
+    way->comp_encoding = encoding;
+}
+
+/**
+ * Compression bookkeeping at the end of an access
+ * @param sac: pointer to cache
+ * @param set_index: index of set
+ * @param way_index: way that was accessed
+ * @param mb_start_addr: start address of memory block
+ * @param was_hit: 1 if the access hit (and the line had to be decompressed)
+ */
+static void account_compression(set_associative_cache* sac, int set_index, int way_index,
+                                void* mb_start_addr, int was_hit)
+{
+    if (was_hit)
+        sac->comp->decompress_cycles
+            += compress_latency(sac->cache_set[set_index].ways[way_index].comp_encoding);
+    comp_baseline_access(sac->comp, set_index,
+                         (uint32_t) (uintptr_t) mb_start_addr >> MAIN_MEMORY_BLOCK_SIZE_LN);
+    sac->comp->valid_line_sum += sac->comp->valid_lines;
+    sac->comp->samples++;
+}
+
 /**
  * Store val at addr (write query)
  * @param sac: pointer to cache
@@ -125,45 +650,74 @@ void sac_store_word(set_associative_cache* sac, void* addr, unsigned int val)
     // Pre-compute start address of memory block
     size_t addr_offt = (size_t) (addr - MAIN_MEMORY_START_ADDR) % MAIN_MEMORY_BLOCK_SIZE;
     void* mb_start_addr = addr - addr_offt;
+    unsigned int sector = 1u << (addr_offt / SET_ASSOCIATIVE_SECTOR_SIZE);
 
-    int set_index = addr_to_set(mb_start_addr);
-    int way_index = find_hit(sac, mb_start_addr, set_index);
+    int set_index = addr_to_set(sac, mb_start_addr, 0);
+    int way_index = find_hit(sac, mb_start_addr, &set_index);
 
-    // Miss - Addr was not previously loaded into cache
-    if (way_index == -1)
+    int was_hit = way_index != -1;
+    if (sac->prof && !was_hit)
+        sp_switch(sac->prof, SP_FILL);
+
+    // Miss that must not allocate - write the word straight to main memory
+    if (!was_hit && must_bypass(sac))
     {
-        // Get least recently used way
-        way_index = lru(sac, set_index);
+        bypass(sac, set_index, addr, mb_start_addr, val, 1);
+        return;
+    }
 
-        // Write memory block to main memory if valid and dirty
-        if (sac->cache_set[set_index].ways[way_index].is_valid == 1 &&
-                sac->cache_set[set_index].ways[way_index].is_dirty == 1)
-            mm_write(sac->mm, sac->cache_set[set_index].ways[way_index].mem_block->start_addr,
-                     sac->cache_set[set_index].ways[way_index].mem_block);
+    // Miss - Addr was not previously loaded into cache
+    if (way_index == -1 && sac->comp)
+    {
+        way_index = compressed_fill(sac, set_index, mb_start_addr);
 
-        // Load memory block from main memory
-        memory_block* mb = mm_read(sac->mm, mb_start_addr);
-        mb_free(sac->cache_set[set_index].ways[way_index].mem_block);
+        sac->cs.w_misses++;
+        sac->tenant_cs[sac->tenant].w_misses++;
+        sac->set_hist[set_index].misses++;
+    }
+    else if (way_index == -1)
+    {
+        // Get least recently used way
+        way_index = choose_victim(sac, mb_start_addr, &set_index);
 
-        sac->cache_set[set_index].ways[way_index].mem_block = mb;
-        sac->cache_set[set_index].ways[way_index].is_valid = 1;
-        sac->cache_set[set_index].ways[way_index].is_dirty = 0;
+        write_back(sac, &sac->cache_set[set_index].ways[way_index]);
+        fill_way(sac, &sac->cache_set[set_index].ways[way_index], mb_start_addr);
 
         sac->cs.w_misses++;
+        sac->set_hist[set_index].misses++;
+        sac->tenant_cs[sac->tenant].w_misses++;
     }
+    if (sac->prof)
+        sp_switch(sac->prof, SP_UPDATE);
+    sac_map_way* way = &sac->cache_set[set_index].ways[way_index];
+
+    // A word store only overwrites part of sectors larger than a word
+    if (SET_ASSOCIATIVE_SECTOR_SIZE > sizeof(unsigned int))
+        fill_sectors(sac, way, sector);
 
     // Extract required word care about
-    unsigned int* mb_addr = sac->cache_set[set_index].ways[way_index].mem_block->data + addr_offt;
+    unsigned int* mb_addr = way->mem_block->data + addr_offt;
     *mb_addr = val;
-    sac->cache_set[set_index].ways[way_index].is_dirty = 1;
+    way->is_dirty = 1;
+    way->valid_mask |= sector;
+    way->dirty_mask |= sector;
+    if (sac->comp)
+    {
+        recompress(sac, set_index, way_index);
+        account_compression(sac, set_index, way_index, mb_start_addr, was_hit);
+    }
 
-    sac->cache_set[set_index].usage[way_index] = 0;
-    for (int i = 0; i < sac->cache_set[set_index].num_ways; i++)
-        if (i != way_index)
-            sac->cache_set[set_index].usage[i]++;
+    // Non-temporal hits keep their LRU position
+    if (!sac->non_temporal)
+        touch_way(sac, mb_start_addr, set_index, way_index);
+    else if (!was_hit)
+        insert_lru(sac, mb_start_addr, set_index, way_index);
+    sac->set_hist[set_index].queries++;
 
     // Update statistics
     sac->cs.w_queries++;
+    sac->tenant_cs[sac->tenant].w_queries++;
+    account_tenant(sac, set_index, mb_start_addr);
 
     // Normalize and adjust to eliminate potential overflows every NEARING_OVERFLOW queries
     if ((sac->cs.w_queries + sac->cs.r_queries) % NEARING_OVERFLOW == 0)
@@ -183,43 +737,71 @@ unsigned int sac_load_word(set_associative_cache* sac, void* addr)
     // Pre-compute start address of memory block
     size_t addr_offt = (size_t) (addr - MAIN_MEMORY_START_ADDR) % MAIN_MEMORY_BLOCK_SIZE;
     void* mb_start_addr = addr - addr_offt;
+    unsigned int sector = 1u << (addr_offt / SET_ASSOCIATIVE_SECTOR_SIZE);
 
-    int set_index = addr_to_set(mb_start_addr);
-    int way_index = find_hit(sac, mb_start_addr, set_index);
+    int set_index = addr_to_set(sac, mb_start_addr, 0);
+    int way_index = find_hit(sac, mb_start_addr, &set_index);
+
+    int was_hit = way_index != -1;
+    if (sac->prof && !was_hit)
+        sp_switch(sac->prof, SP_FILL);
+
+    // Miss that must not allocate - read the word straight from main memory
+    if (!was_hit && must_bypass(sac))
+        return bypass(sac, set_index, addr, mb_start_addr, 0, 0);
 
     // Miss - Addr was not previously loaded into cache
-    if (way_index == -1)
+    if (way_index == -1 && sac->comp)
     {
-        // Get least recently used way
-        way_index = lru(sac, set_index);
-
-        // Write memory block to main memory if valid and dirty
-        if (sac->cache_set[set_index].ways[way_index].is_valid == 1 &&
-            sac->cache_set[set_index].ways[way_index].is_dirty == 1)
-            mm_write(sac->mm, sac->cache_set[set_index].ways[way_index].mem_block->start_addr,
-                     sac->cache_set[set_index].ways[way_index].mem_block);
+        way_index = compressed_fill(sac, set_index, mb_start_addr);
 
-        // Load memory block from main memory
-        memory_block* mb = mm_read(sac->mm, mb_start_addr);
-        mb_free(sac->cache_set[set_index].ways[way_index].mem_block);
+        sac->cs.r_misses++;
+        sac->tenant_cs[sac->tenant].r_misses++;
+        sac->set_hist[set_index].misses++;
+    }
+    else if (way_index == -1)
+    {
+        // Get least recently used way
+        way_index = choose_victim(sac, mb_start_addr, &set_index);
 
-        sac->cache_set[set_index].ways[way_index].mem_block = mb;
-        sac->cache_set[set_index].ways[way_index].is_valid = 1;
-        sac->cache_set[set_index].ways[way_index].is_dirty = 0;
+        write_back(sac, &sac->cache_set[set_index].ways[way_index]);
+        fill_way(sac, &sac->cache_set[set_index].ways[way_index], mb_start_addr);
 
         sac->cs.r_misses++;
+        sac->tenant_cs[sac->tenant].r_misses++;
+        sac->set_hist[set_index].misses++;
     }
+    // Sector miss - block is present but the word was never loaded or written
+    else if (!(sac->cache_set[set_index].ways[way_index].valid_mask & sector))
+    {
+        sac->cs.r_misses++;
+        sac->tenant_cs[sac->tenant].r_misses++;
+        sac->set_hist[set_index].misses++;
+    }
+    if (sac->prof)
+        sp_switch(sac->prof, SP_UPDATE);
+    sac_map_way* way = &sac->cache_set[set_index].ways[way_index];
+
+    // Fetch all missing sectors, the remaining words are likely to be read as well
+    if (!(way->valid_mask & sector))
+        fill_sectors(sac, way, SET_ASSOCIATIVE_FULL_MASK);
 
     // Extract required word care about
-    unsigned int* mb_addr = sac->cache_set[set_index].ways[way_index].mem_block->data + addr_offt;
+    unsigned int* mb_addr = way->mem_block->data + addr_offt;
+    if (sac->comp)
+        account_compression(sac, set_index, way_index, mb_start_addr, was_hit);
 
-    sac->cache_set[set_index].usage[way_index] = 0;
-    for (int i = 0; i < sac->cache_set[set_index].num_ways; i++)
-        if (i != way_index)
-            sac->cache_set[set_index].usage[i]++;
+    // Non-temporal hits keep their LRU position
+    if (!sac->non_temporal)
+        touch_way(sac, mb_start_addr, set_index, way_index);
+    else if (!was_hit)
+        insert_lru(sac, mb_start_addr, set_index, way_index);
+    sac->set_hist[set_index].queries++;
 
     // Update statistics
     sac->cs.r_queries++;
+    sac->tenant_cs[sac->tenant].r_queries++;
+    account_tenant(sac, set_index, mb_start_addr);
 
     // Normalize and adjust to eliminate potential overflows every NEARING_OVERFLOW queries
     if ((sac->cs.w_queries + sac->cs.r_queries) % NEARING_OVERFLOW == 0)
@@ -228,6 +810,55 @@ unsigned int sac_load_word(set_associative_cache* sac, void* addr)
     return *mb_addr;
 }
 
+/**
+ * Clean (write back if dirty) and/or invalidate a way
+ */
+static void maintain_way(set_associative_cache* sac, sac_map_way* way, int op)
+{
+    if (op & MAINT_CLEAN)
+    {
+        write_back(sac, way);
+        way->is_dirty = 0;
+        way->dirty_mask = 0;
+    }
+    if ((op & MAINT_INVALIDATE) && way->is_valid == 1)
+    {
+        if (sac->comp)
+            sac->comp->valid_lines--;
+        way->is_valid = 0;
+        way->is_dirty = 0;
+        way->valid_mask = 0;
+        way->dirty_mask = 0;
+    }
+}
+
+/**
+ * Clean and/or invalidate the line holding addr, if cached
+ * @param sac: pointer to cache
+ * @param op: MAINT_CLEAN, MAINT_INVALIDATE or MAINT_CLEAN_INVALIDATE
+ * @param addr: any address in the block
+ */
+void sac_maintain(set_associative_cache* sac, int op, void* addr)
+{
+    size_t addr_offt = (size_t) (addr - MAIN_MEMORY_START_ADDR) % MAIN_MEMORY_BLOCK_SIZE;
+    void* mb_start_addr = addr - addr_offt;
+    int set_index = addr_to_set(sac, mb_start_addr, 0);
+    int way_index = find_hit(sac, mb_start_addr, &set_index);
+    if (way_index != -1)
+        maintain_way(sac, &sac->cache_set[set_index].ways[way_index], op);
+}
+
+/**
+ * Write back every dirty line and invalidate the whole cache
+ * @param sac: pointer to cache
+ */
+void sac_flush(set_associative_cache* sac)
+{
+    for (int i = 0; i < SET_ASSOCIATIVE_NUM_SETS; i++)
+        for (int j = 0; j < sac->num_tags; j++)
+            maintain_way(sac, &sac->cache_set[i].ways[j], MAINT_CLEAN_INVALIDATE);
+}
+
 /**
  * Free memory allocated to cache
  * @param sac: pointer to cache
@@ -236,12 +867,17 @@ void sac_free(set_associative_cache* sac)
 {
     for (int i = 0; i < SET_ASSOCIATIVE_NUM_SETS; i++)
     {
-        for (int j = 0; j < SET_ASSOCIATIVE_NUM_WAYS; j++)
+        for (int j = 0; j < SET_ASSOCIATIVE_MAX_TAGS; j++)
             mb_free(sac->cache_set[i].ways[j].mem_block);
 
         free(sac->cache_set[i].ways);
         free(sac->cache_set[i].usage);
     }
+    if (sac->ucp)
+        ucp_free(sac->ucp);
+    if (sac->comp)
+        comp_stats_free(sac->comp);
+    free(sac->set_hist);
     free(sac->cache_set);
     free(sac);
 }
\ No newline at end of file
@@ -3,16 +3,32 @@
 
 #include "main_memory.h"
 #include "cache_stats.h"
+#include "ucp.h"
+#include "set_index.h"
+#include "compression.h"
+#include "selfprof.h"
+#include "hotness.h"
+#include "cache_ops.h"
 
 #define SET_ASSOCIATIVE_NUM_SETS 8
 #define SET_ASSOCIATIVE_NUM_SETS_LN 3
 #define SET_ASSOCIATIVE_NUM_WAYS 2
 #define SET_ASSOCIATIVE_NUM_WAYS_LN 1
+#define SET_ASSOCIATIVE_SECTOR_SIZE 4
+#define SET_ASSOCIATIVE_NUM_SECTORS (MAIN_MEMORY_BLOCK_SIZE / SET_ASSOCIATIVE_SECTOR_SIZE)
+#define SET_ASSOCIATIVE_MAX_TENANTS 4
+#define SET_ASSOCIATIVE_MAX_TAGS (2 * SET_ASSOCIATIVE_NUM_WAYS)
+#define SET_ASSOCIATIVE_SET_BYTES (SET_ASSOCIATIVE_NUM_WAYS * MAIN_MEMORY_BLOCK_SIZE)
+#define SET_ASSOCIATIVE_FULL_MASK ((1u << SET_ASSOCIATIVE_NUM_SECTORS) - 1)
 
 typedef struct sac_map_way
 {
     int is_valid;
     int is_dirty;
+    unsigned int valid_mask;
+    unsigned int dirty_mask;
+    int comp_size;
+    int comp_encoding;
     memory_block* mem_block;
 } sac_map_way;
 
@@ -28,6 +44,20 @@ typedef struct set_associative_cache
     main_memory* mm;
     cache_stats cs;
     sac_map_set* cache_set;
+    int sectored;
+    int tenant;
+    int partitioned;
+    unsigned int way_mask[SET_ASSOCIATIVE_MAX_TENANTS];
+    cache_stats tenant_cs[SET_ASSOCIATIVE_MAX_TENANTS];
+    ucp_monitor* ucp;
+    int index_fn;
+    set_stats* set_hist;
+    int num_tags;
+    compression_stats* comp;
+    selfprof* prof;
+    hotness* hot;
+    int non_temporal;
+    int nt_policy;
 } set_associative_cache;
 
 set_associative_cache* sac_init(main_memory* mm);
@@ -36,6 +66,18 @@ void sac_store_word(set_associative_cache* sac, void* addr, unsigned int val);
 
 unsigned int sac_load_word(set_associative_cache* sac, void* addr);
 
+void sac_set_way_mask(set_associative_cache* sac, int tenant, unsigned int mask);
+
+void sac_enable_ucp(set_associative_cache* sac, unsigned int interval);
+
+void sac_enable_compression(set_associative_cache* sac);
+
+void sac_maintain(set_associative_cache* sac, int op, void* addr);
+
+void sac_flush(set_associative_cache* sac);
+
+int sac_set_index(set_associative_cache* sac, void* addr);
+
 void sac_free(set_associative_cache* sac);
 
 #endif
@@ -0,0 +1,99 @@
+#include <string.h>
+
+#include "set_index.h"
+
+/**
+ * Map an index function name given on the command line to its INDEX_* value
+ * @param name: one of modulo, xor, prime or skewed
+ * @return INDEX_* value, -1 if name is not a known index function
+ */
+int idx_parse(const char* name)
+{
+    if (strcmp(name, "modulo") == 0)
+        return INDEX_MODULO;
+    else if (strcmp(name, "xor") == 0)
+        return INDEX_XOR;
+    else if (strcmp(name, "prime") == 0)
+        return INDEX_PRIME;
+    else if (strcmp(name, "skewed") == 0)
+        return INDEX_SKEWED;
+    return -1;
+}
+
+/**
+ * Name of an index function
+ * @param index_fn: INDEX_* value
+ * @return name as accepted by idx_parse
+ */
+const char* idx_name(int index_fn)
+{
+    static const char* names[] = { "modulo", "xor", "prime", "skewed" };
+    return names[index_fn];
+}
+
+/**
+ * Largest prime not above num_sets; prime-modulo indexing leaves the sets
+ * above it unused in exchange for spreading power-of-two strides
+ * @param num_sets: number of sets in the cache
+ * @return number of sets used by INDEX_PRIME
+ */
+int idx_prime_sets(int num_sets)
+{
+    for (int n = num_sets; n > 2; n--)
+    {
+        int is_prime = 1;
+        for (int d = 2; d * d <= n && is_prime; d++)
+            is_prime = n % d != 0;
+        if (is_prime)
+            return n;
+    }
+    return num_sets < 2 ? num_sets : 2;
+}
+
+/**
+ * Rotate the low bits of x left by r positions
+ * @param x: value, only the low bits bits are used
+ * @param r: rotation
+ * @param bits: width of the rotated field
+ * @return rotated value
+ */
+static uint32_t rotate(uint32_t x, int r, int bits)
+{
+    uint32_t mask = (1u << bits) - 1;
+    if (bits == 0)
+        return 0;
+    r %= bits;
+    x &= mask;
+    return ((x << r) | (x >> (bits - r))) & mask;
+}
+
+/**
+ * Compute set index of a block number
+ * INDEX_XOR folds all block number bits onto the index; INDEX_SKEWED uses a
+ * different function per way: the low index-sized chunk XOR the rotated
+ * remaining chunks, with the rotation amount depending on the way
+ * @param index_fn: INDEX_* value
+ * @param block: block number (address >> block size)
+ * @param num_sets_ln: log2 of the number of sets
+ * @param way: way being indexed, only used by INDEX_SKEWED
+ * @return set index
+ */
+int idx_block_to_set(int index_fn, uint32_t block, int num_sets_ln, int way)
+{
+    uint32_t mask = (1u << num_sets_ln) - 1;
+    if (index_fn == INDEX_MODULO || num_sets_ln == 0)
+        return block & mask;
+    if (index_fn == INDEX_PRIME)
+        return block % idx_prime_sets(1 << num_sets_ln);
+
+    uint32_t result = block & mask;
+    int chunk = 1;
+    for (uint32_t rest = block >> num_sets_ln; rest != 0; rest >>= num_sets_ln, chunk++)
+    {
+        if (index_fn == INDEX_SKEWED)
+            result ^= rotate(rest, way * chunk, num_sets_ln);
+        else
+            result ^= rest & mask;
+    }
+    return result;
+}
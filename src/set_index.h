@@ -0,0 +1,19 @@
+#ifndef SET_INDEX_H
+#define SET_INDEX_H
+
+#include <stdint.h>
+
+#define INDEX_MODULO 0
+#define INDEX_XOR 1
+#define INDEX_PRIME 2
+#define INDEX_SKEWED 3
+
+int idx_parse(const char* name);
+
+const char* idx_name(int index_fn);
+
+int idx_prime_sets(int num_sets);
+
+int idx_block_to_set(int index_fn, uint32_t block, int num_sets_ln, int way);
+
+#endif
@@ -8,6 +8,7 @@ simple_cache* sc_init(main_memory* mm)
     simple_cache* result = malloc(sizeof(simple_cache));
     result->mm = mm;
     result->cs = cs_init();
+    result->prof = NULL;
     return result;
 };
 
@@ -17,6 +18,10 @@ void sc_store_word(simple_cache* sc, void* addr, unsigned int val)
     size_t addr_offt = (size_t) (addr - MAIN_MEMORY_START_ADDR) % MAIN_MEMORY_BLOCK_SIZE;
     void* mb_start_addr = addr - addr_offt;
     
+    // Every access is a fill
+    if (sc->prof)
+        sp_switch(sc->prof, SP_FILL);
+
     // Load memory block from main memory
     memory_block* mb = mm_read(sc->mm, mb_start_addr);
     
@@ -28,6 +33,8 @@ void sc_store_word(simple_cache* sc, void* addr, unsigned int val)
     mm_write(sc->mm, mb_start_addr, mb);
     
     // Update statistics
+    if (sc->prof)
+        sp_switch(sc->prof, SP_UPDATE);
     ++sc->cs.w_queries;
     ++sc->cs.w_misses;
     
@@ -41,6 +48,10 @@ unsigned int sc_load_word(simple_cache* sc, void* addr)
     size_t addr_offt = (size_t) (addr - MAIN_MEMORY_START_ADDR) % MAIN_MEMORY_BLOCK_SIZE;
     void* mb_start_addr = addr - addr_offt;
     
+    // Every access is a fill
+    if (sc->prof)
+        sp_switch(sc->prof, SP_FILL);
+
     // Load memory block from main memory
     memory_block* mb = mm_read(sc->mm, mb_start_addr);
     
@@ -49,6 +60,8 @@ unsigned int sc_load_word(simple_cache* sc, void* addr)
     unsigned int result = *mb_addr;
     
     // Update statistics
+    if (sc->prof)
+        sp_switch(sc->prof, SP_UPDATE);
     ++sc->cs.r_queries;
     ++sc->cs.r_misses;
     
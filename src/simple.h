@@ -3,11 +3,13 @@
 
 #include "main_memory.h"
 #include "cache_stats.h"
+#include "selfprof.h"
 
 typedef struct simple_cache
 {
     main_memory* mm;
     cache_stats cs;
+    selfprof* prof;
 } simple_cache;
 
 simple_cache* sc_init(main_memory* mm);
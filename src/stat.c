@@ -0,0 +1,95 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include "live_stats.h"
+
+static double rate(unsigned int hits, unsigned int queries)
+{
+    return queries ? (double) hits / queries * 100 : 0;
+}
+
+/**
+ * Print one status line for a snapshot
+ * @param cur: current snapshot
+ * @param prev: snapshot from the previous update
+ */
+static void print_status(live_stats_data* cur, live_stats_data* prev)
+{
+    cache_stats cs = cur->cs;
+    unsigned int w_hits = cs.w_queries - cs.w_misses;
+    unsigned int r_hits = cs.r_queries - cs.r_misses;
+    double dt = cur->elapsed - prev->elapsed;
+    double lines_per_sec = dt > 0 ? (cur->lines - prev->lines) / dt : 0;
+    double bytes_per_sec = dt > 0 ? (cur->trace_offset - prev->trace_offset) / dt : 0;
+
+    printf("%8.1lfs  %10lu lines  %8.0lf lines/s  W %5.1lf%%  R %5.1lf%%  T %5.1lf%%  MM %u/%u",
+           cur->elapsed, (unsigned long) cur->lines, lines_per_sec,
+           rate(w_hits, cs.w_queries), rate(r_hits, cs.r_queries),
+           rate(w_hits + r_hits, cs.w_queries + cs.r_queries),
+           cur->mm_w_queries, cur->mm_r_queries);
+    if (cur->trace_size > 0)
+    {
+        printf("  %5.1lf%%", (double) cur->trace_offset / cur->trace_size * 100);
+        if (bytes_per_sec > 0 && !cur->finished)
+            printf("  ETA %.0lfs", (cur->trace_size - cur->trace_offset) / bytes_per_sec);
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+/**
+ * Read a snapshot, waiting out slow updates but not a simulator that died
+ * in the middle of one
+ * @param seg: mapped segment
+ * @param out: snapshot
+ */
+static void read_snapshot(live_stats_segment* seg, live_stats_data* out)
+{
+    while (live_read(seg, out) == -1)
+        if (kill(seg->data.pid, 0) == -1)
+        {
+            fprintf(stderr, "Warning: Simulation %d exited without finishing.\n", seg->data.pid);
+            exit(4);
+        }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc > 3)
+    {
+        fprintf(stderr, "Usage: %s shm_name [interval_ms]\n", argv[0]);
+        exit(1);
+    }
+    long interval = argc == 3 ? atol(argv[2]) : 1000;
+
+    live_stats_segment* seg = live_attach(argv[1]);
+    if (seg == NULL)
+    {
+        fprintf(stderr, "Error: No simulation is publishing to %s.\n", argv[1]);
+        exit(3);
+    }
+
+    live_stats_data prev, cur;
+    read_snapshot(seg, &prev);
+    printf("Simulating %s on %s (pid %d)\n", prev.mode, prev.trace, prev.pid);
+    for (;;)
+    {
+        usleep(interval * 1000);
+        read_snapshot(seg, &cur);
+        print_status(&cur, &prev);
+        if (cur.finished)
+            break;
+
+        // The simulator removes the segment on exit; stop if it died instead
+        if (kill(cur.pid, 0) == -1)
+        {
+            fprintf(stderr, "Warning: Simulation %d exited without finishing.\n", cur.pid);
+            exit(4);
+        }
+        prev = cur;
+    }
+    return 0;
+}
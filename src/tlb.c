@@ -0,0 +1,191 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "tlb.h"
+
+/**
+ * Allocate one TLB level, organized like the set associative cache
+ * @param level: level to initialize
+ * @param num_sets: number of sets (power of two), 0 disables the level
+ * @param num_ways: entries per set
+ */
+static void level_init(tlb_level* level, int num_sets, int num_ways)
+{
+    level->num_sets = num_sets;
+    level->num_ways = num_ways;
+    level->entries = calloc(num_sets * num_ways > 0 ? num_sets * num_ways : 1,
+                            sizeof(tlb_entry));
+    level->hits = 0;
+    level->misses = 0;
+}
+
+/**
+ * Allocate TLB hierarchy in front of a cache
+ * Translation is the identity (main memory is the physical address space);
+ * the model accounts for TLB lookups and for the page walk references,
+ * which are issued as loads to the cache
+ * @param c: cache that page walks read page table entries through
+ * @param page_shift: TLB_PAGE_4K, TLB_PAGE_2M or TLB_PAGE_1G
+ * @param l1_sets, l1_ways: L1 TLB geometry
+ * @param l2_sets, l2_ways: L2 TLB geometry, l2_sets == 0 for no L2 TLB
+ * @return initialized TLB
+ */
+tlb* tlb_init(cache* c, int page_shift, int l1_sets, int l1_ways, int l2_sets, int l2_ways)
+{
+    tlb* result = calloc(1, sizeof(tlb));
+    result->c = c;
+    result->page_shift = page_shift;
+    level_init(&result->l1, l1_sets, l1_ways);
+    level_init(&result->l2, l2_sets, l2_ways);
+    return result;
+}
+
+/**
+ * Look up a virtual page number and update LRU usage on a hit
+ * @param level: TLB level
+ * @param vpn: virtual page number
+ * @return 1 on hit, 0 on miss
+ */
+static int level_lookup(tlb_level* level, uint32_t vpn)
+{
+    tlb_entry* set = level->entries + (vpn & (level->num_sets - 1)) * level->num_ways;
+    for (int i = 0; i < level->num_ways; i++)
+    {
+        if (set[i].is_valid && set[i].vpn == vpn)
+        {
+            for (int j = 0; j < level->num_ways; j++)
+                set[j].usage++;
+            set[i].usage = 0;
+            level->hits++;
+            return 1;
+        }
+    }
+    level->misses++;
+    return 0;
+}
+
+/**
+ * Insert a translation, replacing an invalid or the least recently used entry
+ * @param level: TLB level
+ * @param vpn: virtual page number
+ */
+static void level_insert(tlb_level* level, uint32_t vpn)
+{
+    tlb_entry* set = level->entries + (vpn & (level->num_sets - 1)) * level->num_ways;
+    int victim = 0;
+    for (int i = 0; i < level->num_ways; i++)
+    {
+        if (!set[i].is_valid)
+        {
+            victim = i;
+            break;
+        }
+        if (set[i].usage > set[victim].usage)
+            victim = i;
+    }
+
+    for (int j = 0; j < level->num_ways; j++)
+        set[j].usage++;
+    set[victim].is_valid = 1;
+    set[victim].vpn = vpn;
+    set[victim].usage = 0;
+}
+
+/**
+ * Walk the radix page table down to the level mapping the page size,
+ * loading one entry per level through the cache
+ * @param t: pointer to TLB
+ * @param addr: virtual address being translated
+ */
+static void page_walk(tlb* t, uint32_t addr)
+{
+    cache_stats* cs = cache_get_stats(t->c);
+    int leaf_level = TLB_WALK_LEVELS - 1 - (t->page_shift - TLB_PAGE_4K) / TLB_LEVEL_BITS;
+    t->walks++;
+
+    for (int level = 0; level <= leaf_level; level++)
+    {
+        int shift = TLB_PAGE_4K + (TLB_WALK_LEVELS - 1 - level) * TLB_LEVEL_BITS;
+        uint32_t index = (uint32_t) ((uint64_t) addr >> shift) & (TLB_TABLE_ENTRIES - 1);
+        uintptr_t pte = TLB_PAGE_TABLE_BASE + level * TLB_TABLE_SIZE + index * TLB_PTE_SIZE;
+
+        unsigned int misses = cs->r_misses;
+        cache_load_word(t->c, (void*) pte);
+        t->walk_refs++;
+        if (cs->r_misses != misses)
+        {
+            t->walk_misses++;
+            t->walk_cycles += TLB_WALK_MISS_CYCLES;
+        }
+        else
+            t->walk_cycles += TLB_WALK_HIT_CYCLES;
+    }
+}
+
+/**
+ * Translate a virtual address, walking the page table on a miss in all levels
+ * @param t: pointer to TLB
+ * @param addr: virtual address
+ * @return physical address
+ */
+void* tlb_translate(tlb* t, void* addr)
+{
+    uint32_t vpn = (uint32_t) ((uint64_t) (uintptr_t) addr >> t->page_shift);
+
+    if (level_lookup(&t->l1, vpn))
+        return addr;
+
+    if (t->l2.num_sets > 0)
+    {
+        t->l2_cycles += TLB_L2_HIT_CYCLES;
+        if (level_lookup(&t->l2, vpn))
+        {
+            level_insert(&t->l1, vpn);
+            return addr;
+        }
+    }
+
+    page_walk(t, (uint32_t) (uintptr_t) addr);
+    if (t->l2.num_sets > 0)
+        level_insert(&t->l2, vpn);
+    level_insert(&t->l1, vpn);
+    return addr;
+}
+
+/**
+ * Print TLB hit rates and page walk cost
+ * @param t: pointer to TLB
+ */
+void tlb_print(tlb* t)
+{
+    unsigned int l1_queries = t->l1.hits + t->l1.misses;
+    unsigned int l2_queries = t->l2.hits + t->l2.misses;
+
+    if (t->page_shift >= TLB_PAGE_1G)
+        printf("Page Size:\t\t%dGB\n", 1 << (t->page_shift - 30));
+    else if (t->page_shift >= TLB_PAGE_2M)
+        printf("Page Size:\t\t%dMB\n", 1 << (t->page_shift - 20));
+    else
+        printf("Page Size:\t\t%dKB\n", 1 << (t->page_shift - 10));
+    printf("L1 TLB Hit Rate:\t%.0lf%% (%u/%u)\n",
+           l1_queries ? (double) t->l1.hits / l1_queries * 100 : 0, t->l1.hits, l1_queries);
+    if (t->l2.num_sets > 0)
+        printf("L2 TLB Hit Rate:\t%.0lf%% (%u/%u)\n",
+               l2_queries ? (double) t->l2.hits / l2_queries * 100 : 0, t->l2.hits, l2_queries);
+    printf("Page Walks:\t\t%u\n", t->walks);
+    printf("Walk References:\t%u (%u cache misses)\n", t->walk_refs, t->walk_misses);
+    printf("Walk Cycles:\t\t%lu\n", t->walk_cycles);
+    printf("Translation Cycles:\t%lu\n", t->walk_cycles + t->l2_cycles);
+    printf("*******************************************\n");
+}
+
+/**
+ * Free memory allocated to TLB (the cache is not free'd)
+ * @param t: pointer to TLB
+ */
+void tlb_free(tlb* t)
+{
+    free(t->l1.entries);
+    free(t->l2.entries);
+    free(t);
+}
@@ -0,0 +1,71 @@
+#ifndef TLB_H
+#define TLB_H
+
+#include <stdint.h>
+
+#include "cache.h"
+
+#define TLB_L1_NUM_SETS 4
+#define TLB_L1_NUM_WAYS 4
+#define TLB_L2_NUM_SETS 16
+#define TLB_L2_NUM_WAYS 8
+
+#define TLB_PAGE_4K 12
+#define TLB_PAGE_2M 21
+#define TLB_PAGE_1G 30
+
+// Four-level radix page table with 9 index bits per level (x86-64 layout)
+#define TLB_WALK_LEVELS 4
+#define TLB_LEVEL_BITS 9
+#define TLB_PTE_SIZE 8
+
+// Page tables live at the top of main memory; each table is truncated to the
+// entries the simulated address space can reach
+#define TLB_TABLE_ENTRIES 64
+#define TLB_TABLE_SIZE (TLB_TABLE_ENTRIES * TLB_PTE_SIZE)
+#define TLB_PAGE_TABLE_BASE (MAIN_MEMORY_SIZE - TLB_WALK_LEVELS * TLB_TABLE_SIZE)
+
+// Latencies in cycles
+#define TLB_L2_HIT_CYCLES 7
+#define TLB_WALK_HIT_CYCLES 4
+#define TLB_WALK_MISS_CYCLES 100
+
+typedef struct tlb_entry
+{
+    int is_valid;
+    uint32_t vpn;
+    float usage;
+} tlb_entry;
+
+typedef struct tlb_level
+{
+    int num_sets;
+    int num_ways;
+    tlb_entry* entries;
+    unsigned int hits;
+    unsigned int misses;
+} tlb_level;
+
+typedef struct tlb
+{
+    tlb_level l1;
+    tlb_level l2;
+    int page_shift;
+    cache* c;
+
+    unsigned int walks;
+    unsigned int walk_refs;
+    unsigned int walk_misses;
+    unsigned long walk_cycles;
+    unsigned long l2_cycles;
+} tlb;
+
+tlb* tlb_init(cache* c, int page_shift, int l1_sets, int l1_ways, int l2_sets, int l2_ways);
+
+void* tlb_translate(tlb* t, void* addr);
+
+void tlb_print(tlb* t);
+
+void tlb_free(tlb* t);
+
+#endif
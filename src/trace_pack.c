@@ -0,0 +1,362 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "trace_pack.h"
+#include "trace_record.h"
+
+// Token: word delta << 4 | stream << 2 | op. An escape token (low bits
+// TP_ESCAPE) carries op << 2 | tenant flag << 4 | stream << 5 and is followed
+// by a byte delta, for unaligned or huge deltas, tagged accesses and ops past
+// TRACE_OP_FETCH; for those the op field is TP_ESCAPE and an op byte follows.
+#define TP_ESCAPE 3
+#define TP_TENANT_FLAG 16
+#define TP_TOKEN_SHIFT 4
+
+// Jumps of at least this many words start a new stream instead of moving one
+#define TP_FAR_WORDS 4096
+
+static uint8_t* put_varint(uint8_t* p, uint64_t v)
+{
+    while (v >= 0x80)
+    {
+        *p++ = (uint8_t) v | 0x80;
+        v >>= 7;
+    }
+    *p++ = (uint8_t) v;
+    return p;
+}
+
+static const uint8_t* get_varint(const uint8_t* p, const uint8_t* end, uint64_t* v)
+{
+    uint64_t result = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7)
+    {
+        uint8_t byte = *p++;
+        result |= (uint64_t) (byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+        {
+            *v = result;
+            return p;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Create a packed trace
+ * @param path: output file
+ * @return writer
+ */
+tp_writer* tp_create(const char* path)
+{
+    tp_writer* result = calloc(1, sizeof(tp_writer));
+    result->file = fopen(path, "wb");
+    if (result->file == NULL)
+    {
+        fprintf(stderr, "Error: Could not open %s.\n", path);
+        exit(3);
+    }
+    result->buf = malloc((size_t) TP_BLOCK_RECORDS * TP_MAX_RECORD_BYTES);
+    result->index_size = 64;
+    result->index = malloc(result->index_size * sizeof(tp_block));
+
+    tp_header header = { TRACE_PACK_MAGIC, TRACE_PACK_VERSION, TP_BLOCK_RECORDS, 0 };
+    fwrite(&header, sizeof(header), 1, result->file);
+    result->offset = sizeof(header);
+    return result;
+}
+
+static void flush_block(tp_writer* w)
+{
+    if (w->blocks == w->index_size)
+    {
+        w->index_size *= 2;
+        w->index = realloc(w->index, w->index_size * sizeof(tp_block));
+    }
+    tp_block* b = &w->index[w->blocks++];
+    b->offset = w->offset;
+    b->first_record = w->records - w->block_len;
+    b->size = w->buf_len;
+    b->records = w->block_len;
+    fwrite(w->buf, 1, w->buf_len, w->file);
+
+    w->offset += w->buf_len;
+    w->buf_len = 0;
+    w->block_len = 0;
+    memset(w->streams, 0, sizeof(w->streams));
+    w->victim = 0;
+}
+
+static uint64_t zigzag(int64_t v)
+{
+    return ((uint64_t) v << 1) ^ (uint64_t) (v >> 63);
+}
+
+static int64_t unzigzag(uint64_t v)
+{
+    return (int64_t) (v >> 1) ^ -(int64_t) (v & 1);
+}
+
+/**
+ * Append one access. Addresses are coded as a varint delta from the nearest of
+ * TP_STREAMS recent addresses, so interleaved sequential streams stay one or
+ * two bytes each; written values are zigzag varints.
+ * @param w: writer
+ * @param op: TRACE_OP_* value
+ * @param addr: accessed address
+ * @param val: value stored, ignored unless op is TRACE_OP_WRITE or TRACE_OP_NT_WRITE
+ * @param tenant: tenant tag
+ */
+void tp_append(tp_writer* w, uint8_t op, uint64_t addr, uint32_t val, uint8_t tenant)
+{
+    uint8_t* p = w->buf + w->buf_len;
+    uint32_t stream = 0;
+    uint64_t best = UINT64_MAX;
+    for (uint32_t i = 0; i < TP_STREAMS; i++)
+    {
+        uint64_t distance = addr >= w->streams[i] ? addr - w->streams[i] : w->streams[i] - addr;
+        if (distance < best)
+        {
+            best = distance;
+            stream = i;
+        }
+    }
+    if (best >= TP_FAR_WORDS * 4)
+    {
+        stream = w->victim;
+        w->victim = (w->victim + 1) % TP_STREAMS;
+    }
+    int64_t delta = (int64_t) (addr - w->streams[stream]);
+    uint64_t words = zigzag(delta >> 2);
+
+    if (tenant == 0 && (delta & 3) == 0 && op < TP_ESCAPE && words < (1ull << (64 - TP_TOKEN_SHIFT)))
+        p = put_varint(p, words << TP_TOKEN_SHIFT | stream << 2 | op);
+    else
+    {
+        int extended = op >= TP_ESCAPE;
+        *p++ = (uint8_t) (stream << 5 | (tenant ? TP_TENANT_FLAG : 0)
+                          | (extended ? TP_ESCAPE : op) << 2 | TP_ESCAPE);
+        if (extended)
+            *p++ = op;
+        p = put_varint(p, zigzag(delta));
+    }
+    if (op == TRACE_OP_WRITE || op == TRACE_OP_NT_WRITE)
+        p = put_varint(p, ((uint32_t) val << 1) ^ (uint32_t) ((int32_t) val >> 31));
+    if (tenant)
+        *p++ = tenant;
+
+    w->buf_len = p - w->buf;
+    w->streams[stream] = addr;
+    ++w->records;
+    if (++w->block_len == TP_BLOCK_RECORDS)
+        flush_block(w);
+}
+
+/**
+ * Write the last block, the block index and the trailer, then free the writer
+ * @param w: writer
+ */
+void tp_finish(tp_writer* w)
+{
+    if (w->block_len > 0)
+        flush_block(w);
+    tp_trailer trailer = { w->offset, w->records, w->blocks, TRACE_PACK_MAGIC };
+    fwrite(w->index, sizeof(tp_block), w->blocks, w->file);
+    fwrite(&trailer, sizeof(trailer), 1, w->file);
+    if (ferror(w->file) || fclose(w->file) != 0)
+    {
+        fprintf(stderr, "Error: Could not write packed trace.\n");
+        exit(3);
+    }
+    free(w->buf);
+    free(w->index);
+    free(w);
+}
+
+/**
+ * Load the block index from the end of a packed trace
+ * @param file: packed trace
+ * @return index, NULL if the trailer or index is malformed
+ */
+tp_index* tp_read_index(FILE* file)
+{
+    tp_trailer trailer;
+    if (fseek(file, -(long) sizeof(trailer), SEEK_END) != 0
+        || fread(&trailer, sizeof(trailer), 1, file) != 1
+        || trailer.magic != TRACE_PACK_MAGIC
+        || fseek(file, trailer.index_offset, SEEK_SET) != 0)
+        return NULL;
+
+    tp_index* result = calloc(1, sizeof(tp_index));
+    result->blocks = malloc((trailer.blocks + 1) * sizeof(tp_block));
+    result->num_blocks = trailer.blocks;
+    result->records = trailer.records;
+    uint64_t expected = 0;
+    int valid = fread(result->blocks, sizeof(tp_block), trailer.blocks, file) == trailer.blocks;
+    for (uint32_t i = 0; valid && i < trailer.blocks; i++)
+    {
+        tp_block* b = &result->blocks[i];
+        valid = b->first_record == expected && b->records <= TP_BLOCK_RECORDS
+                && (b->records == TP_BLOCK_RECORDS || i == trailer.blocks - 1)
+                && b->offset + b->size <= trailer.index_offset;
+        expected += b->records;
+        if (b->size > result->max_size)
+            result->max_size = b->size;
+    }
+    if (!valid || expected != trailer.records)
+    {
+        tp_free_index(result);
+        return NULL;
+    }
+    return result;
+}
+
+/**
+ * Find the block holding a record
+ * @param index: block index
+ * @param record: record number from the start of the trace
+ * @return block number, num_blocks if record is past the end
+ */
+uint32_t tp_find_block(tp_index* index, uint64_t record)
+{
+    if (record >= index->records)
+        return index->num_blocks;
+    uint32_t lo = 0;
+    uint32_t hi = index->num_blocks - 1;
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo + 1) / 2;
+        if (index->blocks[mid].first_record <= record)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return lo;
+}
+
+typedef struct decode_job
+{
+    const uint8_t* data;
+    const tp_block* block;
+    tp_access* out;
+    int status;
+    int threaded;
+    pthread_t thread;
+} decode_job;
+
+static void* decode_block(void* arg)
+{
+    decode_job* job = arg;
+    const uint8_t* p = job->data;
+    const uint8_t* end = p + job->block->size;
+    uint64_t streams[TP_STREAMS] = { 0 };
+    uint64_t v;
+
+    for (uint32_t i = 0; i < job->block->records; i++)
+    {
+        tp_access* a = &job->out[i];
+        if ((p = get_varint(p, end, &v)) == NULL)
+            return NULL;
+        uint64_t delta;
+        int has_tenant = 0;
+        uint32_t stream = (v >> 2) & 3;
+        if ((v & 3) == TP_ESCAPE)
+        {
+            a->op = (v >> 2) & 3;
+            has_tenant = (v & TP_TENANT_FLAG) != 0;
+            stream = v >> 5;
+            if (a->op == TP_ESCAPE)
+            {
+                if (p == end)
+                    return NULL;
+                a->op = *p++;
+            }
+            if (a->op > TRACE_OP_FLUSH || stream >= TP_STREAMS || (p = get_varint(p, end, &delta)) == NULL)
+                return NULL;
+            delta = (uint64_t) unzigzag(delta);
+        }
+        else
+        {
+            a->op = v & 3;
+            delta = (uint64_t) unzigzag(v >> TP_TOKEN_SHIFT) << 2;
+        }
+        a->addr = streams[stream] + delta;
+        streams[stream] = a->addr;
+
+        a->val = 0;
+        if (a->op == TRACE_OP_WRITE || a->op == TRACE_OP_NT_WRITE)
+        {
+            if ((p = get_varint(p, end, &v)) == NULL)
+                return NULL;
+            a->val = (uint32_t) unzigzag(v);
+        }
+        a->tenant = 0;
+        if (has_tenant)
+        {
+            if (p == end)
+                return NULL;
+            a->tenant = *p++;
+        }
+    }
+    job->status = p == end ? 0 : -1;
+    return NULL;
+}
+
+/**
+ * Decode consecutive blocks, one thread per block
+ * @param file: packed trace
+ * @param index: block index
+ * @param first: first block to decode
+ * @param count: number of blocks, at most TP_DECODE_THREADS
+ * @param out: room for count * TP_BLOCK_RECORDS accesses; block i starts at
+ *             out + i * TP_BLOCK_RECORDS
+ * @return 0 on success, -1 if the file is truncated or a block is corrupt
+ */
+int tp_decode_blocks(FILE* file, tp_index* index, uint32_t first, uint32_t count, tp_access* out)
+{
+    tp_block* blocks = &index->blocks[first];
+    size_t size = blocks[count - 1].offset + blocks[count - 1].size - blocks[0].offset;
+    uint8_t* data = malloc(size);
+    if (fseek(file, blocks[0].offset, SEEK_SET) != 0 || fread(data, 1, size, file) != size)
+    {
+        free(data);
+        return -1;
+    }
+
+    decode_job jobs[TP_DECODE_THREADS];
+    for (uint32_t i = 0; i < count; i++)
+    {
+        jobs[i].data = data + (blocks[i].offset - blocks[0].offset);
+        jobs[i].block = &blocks[i];
+        jobs[i].out = out + (size_t) i * TP_BLOCK_RECORDS;
+        jobs[i].status = -1;
+        jobs[i].threaded = i > 0 && pthread_create(&jobs[i].thread, NULL, decode_block, &jobs[i]) == 0;
+    }
+    for (uint32_t i = 0; i < count; i++)
+        if (!jobs[i].threaded)
+            decode_block(&jobs[i]);
+
+    int result = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (jobs[i].threaded)
+            pthread_join(jobs[i].thread, NULL);
+        if (jobs[i].status != 0)
+            result = -1;
+    }
+    free(data);
+    return result;
+}
+
+/**
+ * Free a block index
+ * @param index: block index
+ */
+void tp_free_index(tp_index* index)
+{
+    free(index->blocks);
+    free(index);
+}
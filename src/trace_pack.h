@@ -0,0 +1,91 @@
+#ifndef TRACE_PACK_H
+#define TRACE_PACK_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Packed traces: header, independently decodable blocks, block index, trailer
+#define TRACE_PACK_MAGIC 0x4b504354u
+#define TRACE_PACK_VERSION 1
+
+// Records per block and blocks decoded in parallel by a reader
+#define TP_BLOCK_RECORDS 65536
+#define TP_DECODE_THREADS 4
+
+// Recent addresses a record's address delta may be taken from
+#define TP_STREAMS 4
+
+// Longest encoding of one record: escape and op bytes, delta and value varints, tenant
+#define TP_MAX_RECORD_BYTES 18
+
+typedef struct tp_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t block_records;
+    uint32_t flags;
+} tp_header;
+
+typedef struct tp_block
+{
+    uint64_t offset;
+    uint64_t first_record;
+    uint32_t size;
+    uint32_t records;
+} tp_block;
+
+typedef struct tp_trailer
+{
+    uint64_t index_offset;
+    uint64_t records;
+    uint32_t blocks;
+    uint32_t magic;
+} tp_trailer;
+
+// One decoded access; op is a TRACE_OP_* value
+typedef struct tp_access
+{
+    uint64_t addr;
+    uint32_t val;
+    uint8_t op;
+    uint8_t tenant;
+} tp_access;
+
+typedef struct tp_writer
+{
+    FILE* file;
+    uint8_t* buf;
+    size_t buf_len;
+    uint64_t streams[TP_STREAMS];
+    uint32_t victim;
+    uint32_t block_len;
+    tp_block* index;
+    uint32_t blocks;
+    uint32_t index_size;
+    uint64_t records;
+    uint64_t offset;
+} tp_writer;
+
+typedef struct tp_index
+{
+    tp_block* blocks;
+    uint32_t num_blocks;
+    uint64_t records;
+    uint32_t max_size;
+} tp_index;
+
+tp_writer* tp_create(const char* path);
+
+void tp_append(tp_writer* w, uint8_t op, uint64_t addr, uint32_t val, uint8_t tenant);
+
+void tp_finish(tp_writer* w);
+
+tp_index* tp_read_index(FILE* file);
+
+uint32_t tp_find_block(tp_index* index, uint64_t record);
+
+int tp_decode_blocks(FILE* file, tp_index* index, uint32_t first, uint32_t count, tp_access* out);
+
+void tp_free_index(tp_index* index);
+
+#endif
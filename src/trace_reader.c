@@ -0,0 +1,272 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "trace_reader.h"
+#include "main_memory.h"
+#include "set_associative.h"
+
+/**
+ * Open a trace, detecting the binary format from its header
+ * @param path: trace file
+ * @return reader, NULL if the file cannot be opened
+ */
+trace_reader* tr_open(const char* path)
+{
+    FILE* file = fopen(path, "r");
+    if (file == 0)
+        return NULL;
+
+    trace_reader* result = calloc(1, sizeof(trace_reader));
+    result->file = file;
+
+    trace_file_header header;
+    int has_header = fread(&header, sizeof(header), 1, file) == 1;
+    if (has_header && header.magic == TRACE_FILE_MAGIC)
+    {
+        if (header.version != TRACE_FILE_VERSION || header.record_size != sizeof(trace_record))
+        {
+            fprintf(stderr, "Error: Unsupported binary trace version %u.\n", header.version);
+            exit(3);
+        }
+        result->format = TRACE_FORMAT_BINARY;
+        result->offset = sizeof(header);
+    }
+    else if (has_header && header.magic == TRACE_PACK_MAGIC)
+    {
+        if (header.version != TRACE_PACK_VERSION || header.record_size != TP_BLOCK_RECORDS)
+        {
+            fprintf(stderr, "Error: Unsupported packed trace version %u.\n", header.version);
+            exit(3);
+        }
+        result->index = tp_read_index(file);
+        if (result->index == NULL)
+        {
+            fprintf(stderr, "Error: Corrupt packed trace index in %s.\n", path);
+            exit(3);
+        }
+        result->format = TRACE_FORMAT_PACKED;
+        result->batch = malloc((size_t) TP_DECODE_THREADS * TP_BLOCK_RECORDS * sizeof(tp_access));
+        result->offset = sizeof(header);
+    }
+    else
+        rewind(file);
+    return result;
+}
+
+/**
+ * Continue reading from a position returned by an earlier run
+ * @param tr: reader
+ * @param offset: byte offset in the file
+ * @param line_num: lines (or records) before offset; packed traces seek by
+ *                  record number alone
+ * @return 0 on success, -1 if the file cannot seek there
+ */
+int tr_seek(trace_reader* tr, long offset, unsigned int line_num)
+{
+    if (tr->format == TRACE_FORMAT_PACKED)
+    {
+        if (line_num > tr->index->records)
+            return -1;
+        tr->line_num = line_num;
+        return 0;
+    }
+    if (fseek(tr->file, offset, SEEK_SET) != 0)
+        return -1;
+    tr->offset = offset;
+    tr->line_num = line_num;
+    return 0;
+}
+
+/**
+ * Map a traced address into the simulated memory: addresses beyond it (e.g.
+ * virtual addresses from a traced service) are folded into it and aligned
+ * down to a word, so any record can be simulated
+ * @param addr: address as recorded
+ * @return simulated address
+ */
+void* tr_fold_addr(uint64_t addr)
+{
+    return (void*) (uintptr_t) ((addr % MAIN_MEMORY_SIZE) & ~(uint64_t) (sizeof(unsigned int) - 1));
+}
+
+/**
+ * Parse one text line: R/I/L addr, W/S addr val, C/V/X addr or F, with an
+ * optional @T tenant tag
+ */
+static int next_text(trace_reader* tr, char* RW, void** addr, unsigned int* val, int* tenant)
+{
+    ssize_t read_len = getline(&tr->line, &tr->line_len, tr->file);
+    if (read_len == -1)
+        return TRACE_READ_EOF;
+    ++tr->line_num;
+    tr->offset += read_len;
+
+    char* line = tr->line;
+    int tolkens_found = sscanf(line, "%c %p %d", RW, addr, val);
+    if (strlen(line) == 1 || *RW == '#')
+        return TRACE_READ_SKIP;
+
+    int has_val = *RW == 'W' || *RW == 'S';
+    if (*RW == '\0' || strchr(TRACE_OP_CHARS, *RW) == NULL
+        || (*RW == 'F' && tolkens_found != 1)
+        || (*RW != 'F' && !has_val && tolkens_found != 2)
+        || (has_val && tolkens_found !=3))
+    {
+        fprintf(stderr, "Warning: Format error on line %d: %s", tr->line_num, line);
+        return TRACE_READ_SKIP;
+    }
+
+    *addr = *RW == 'F' ? NULL : tr_fold_addr((uintptr_t) *addr);
+
+    char* tag = strchr(line, '@');
+    *tenant = tag ? atoi(tag + 1) : 0;
+    if (*tenant < 0 || *tenant >= SET_ASSOCIATIVE_MAX_TENANTS)
+    {
+        fprintf(stderr, "Warning: Tenant out of range on line %d: %s", tr->line_num, line);
+        *tenant = 0;
+    }
+    return TRACE_READ_ACCESS;
+}
+
+/**
+ * Decode one binary record
+ */
+static int next_binary(trace_reader* tr, char* RW, void** addr, unsigned int* val, int* tenant)
+{
+    trace_record r;
+    if (fread(&r, sizeof(r), 1, tr->file) != 1)
+        return TRACE_READ_EOF;
+    ++tr->line_num;
+    tr->offset += sizeof(r);
+
+    if (r.op > TRACE_OP_FLUSH)
+    {
+        fprintf(stderr, "Warning: Format error on record %d: op %u\n", tr->line_num, r.op);
+        return TRACE_READ_SKIP;
+    }
+    *RW = TRACE_OP_CHARS[r.op];
+    *addr = tr_fold_addr(r.addr);
+    *val = r.val;
+    *tenant = r.tenant;
+    if (*tenant >= SET_ASSOCIATIVE_MAX_TENANTS)
+    {
+        fprintf(stderr, "Warning: Tenant out of range on record %d: %d\n", tr->line_num, *tenant);
+        *tenant = 0;
+    }
+    return TRACE_READ_ACCESS;
+}
+
+/**
+ * Decode the batch of blocks starting with the one holding the next record
+ * @return 0, or -1 at the end of the trace
+ */
+static int load_batch(trace_reader* tr)
+{
+    tp_index* index = tr->index;
+    uint32_t first = tp_find_block(index, tr->line_num);
+    if (first == index->num_blocks)
+        return -1;
+    uint32_t count = index->num_blocks - first;
+    if (count > TP_DECODE_THREADS)
+        count = TP_DECODE_THREADS;
+    if (tp_decode_blocks(tr->file, index, first, count, tr->batch) != 0)
+    {
+        fprintf(stderr, "Error: Corrupt packed trace block %u.\n", first);
+        exit(3);
+    }
+    tp_block* last = &index->blocks[first + count - 1];
+    tr->batch_first = index->blocks[first].first_record;
+    tr->batch_end = last->first_record + last->records;
+    tr->offset = last->offset + last->size;
+    return 0;
+}
+
+/**
+ * Return one access from the decoded batch, decoding the next one when it runs out
+ */
+static int next_packed(trace_reader* tr, char* RW, void** addr, unsigned int* val, int* tenant)
+{
+    if ((tr->line_num < tr->batch_first || tr->line_num >= tr->batch_end) && load_batch(tr) != 0)
+        return TRACE_READ_EOF;
+    tp_access* a = &tr->batch[tr->line_num - tr->batch_first];
+    ++tr->line_num;
+
+    if (a->op > TRACE_OP_FLUSH)
+    {
+        fprintf(stderr, "Warning: Format error on record %d: op %u\n", tr->line_num, a->op);
+        return TRACE_READ_SKIP;
+    }
+    *RW = TRACE_OP_CHARS[a->op];
+    *addr = tr_fold_addr(a->addr);
+    *val = a->val;
+    *tenant = a->tenant;
+    if (*tenant >= SET_ASSOCIATIVE_MAX_TENANTS)
+    {
+        fprintf(stderr, "Warning: Tenant out of range on record %d: %d\n", tr->line_num, *tenant);
+        *tenant = 0;
+    }
+    return TRACE_READ_ACCESS;
+}
+
+/**
+ * Read the next trace entry
+ * @param tr: reader
+ * @param RW: 'R', 'W' or 'I'
+ * @param addr: accessed address
+ * @param val: value stored, only set for 'W'
+ * @param tenant: tenant tag, 0 if none
+ * @return TRACE_READ_ACCESS, TRACE_READ_SKIP for blank, comment or malformed
+ *         entries (a warning is printed for the latter), TRACE_READ_EOF
+ */
+int tr_next(trace_reader* tr, char* RW, void** addr, unsigned int* val, int* tenant)
+{
+    if (tr->format == TRACE_FORMAT_PACKED)
+        return next_packed(tr, RW, addr, val, tenant);
+    if (tr->format == TRACE_FORMAT_BINARY)
+        return next_binary(tr, RW, addr, val, tenant);
+    return next_text(tr, RW, addr, val, tenant);
+}
+
+/**
+ * Skip accesses without simulating them. Binary and packed traces seek
+ * straight to the record; text traces are parsed up to it.
+ * @param tr: reader
+ * @param records: number of accesses to skip
+ */
+void tr_skip(trace_reader* tr, unsigned int records)
+{
+    if (tr->format == TRACE_FORMAT_PACKED)
+    {
+        uint64_t target = (uint64_t) tr->line_num + records;
+        tr->line_num = target < tr->index->records ? target : tr->index->records;
+    }
+    else if (tr->format == TRACE_FORMAT_BINARY)
+        tr_seek(tr, tr->offset + (long) records * sizeof(trace_record), tr->line_num + records);
+    else
+    {
+        char RW;
+        void* addr;
+        unsigned int val;
+        int tenant;
+        int status;
+        while (records > 0 && (status = tr_next(tr, &RW, &addr, &val, &tenant)) != TRACE_READ_EOF)
+            if (status == TRACE_READ_ACCESS)
+                --records;
+    }
+}
+
+/**
+ * Close trace and free reader
+ * @param tr: reader
+ */
+void tr_close(trace_reader* tr)
+{
+    fclose(tr->file);
+    if (tr->index)
+        tp_free_index(tr->index);
+    free(tr->batch);
+    free(tr->line);
+    free(tr);
+}
@@ -0,0 +1,44 @@
+#ifndef TRACE_READER_H
+#define TRACE_READER_H
+
+#include <stdio.h>
+
+#include "trace_pack.h"
+#include "trace_record.h"
+
+#define TRACE_FORMAT_TEXT 0
+#define TRACE_FORMAT_BINARY 1
+#define TRACE_FORMAT_PACKED 2
+
+#define TRACE_READ_EOF -1
+#define TRACE_READ_SKIP 0
+#define TRACE_READ_ACCESS 1
+
+typedef struct trace_reader
+{
+    FILE* file;
+    int format;
+    char* line;
+    size_t line_len;
+    long offset;
+    unsigned int line_num;
+    // Packed traces: decoded blocks holding records batch_first to batch_end - 1
+    tp_index* index;
+    tp_access* batch;
+    uint64_t batch_first;
+    uint64_t batch_end;
+} trace_reader;
+
+trace_reader* tr_open(const char* path);
+
+int tr_seek(trace_reader* tr, long offset, unsigned int line_num);
+
+void* tr_fold_addr(uint64_t addr);
+
+void tr_skip(trace_reader* tr, unsigned int records);
+
+int tr_next(trace_reader* tr, char* RW, void** addr, unsigned int* val, int* tenant);
+
+void tr_close(trace_reader* tr);
+
+#endif
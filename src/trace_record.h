@@ -0,0 +1,65 @@
+#ifndef TRACE_RECORD_H
+#define TRACE_RECORD_H
+
+#include <stdint.h>
+
+#include "cache_stats.h"
+
+// Binary access record, the counterpart of one trace line
+#define TRACE_OP_READ 0
+#define TRACE_OP_WRITE 1
+#define TRACE_OP_FETCH 2
+#define TRACE_OP_NT_READ 3
+#define TRACE_OP_NT_WRITE 4
+#define TRACE_OP_CLEAN 5
+#define TRACE_OP_INVALIDATE 6
+#define TRACE_OP_CLEAN_INVALIDATE 7
+#define TRACE_OP_FLUSH 8
+
+// Trace line letter of each op
+#define TRACE_OP_CHARS "RWILSCVXF"
+
+typedef struct trace_record
+{
+    uint32_t addr;
+    uint32_t val;
+    uint8_t op;
+    uint8_t tenant;
+    uint16_t reserved;
+} trace_record;
+
+// Binary trace files are this header followed by trace_record entries
+#define TRACE_FILE_MAGIC 0x52544143u
+#define TRACE_FILE_VERSION 1
+
+typedef struct trace_file_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t flags;
+} trace_file_header;
+
+// Messages on a simulation server socket start with this header
+#define TRACE_MSG_BATCH 1
+#define TRACE_MSG_STATS 2
+
+typedef struct trace_msg_header
+{
+    uint32_t type;
+    uint32_t count;
+} trace_msg_header;
+
+// Reply to TRACE_MSG_STATS, sent after a header with count 1
+typedef struct trace_stats_reply
+{
+    uint64_t records;
+    uint64_t rejected;
+    cache_stats cs;
+    uint32_t mm_w_queries;
+    uint32_t mm_r_queries;
+    uint32_t mm_w_bytes;
+    uint32_t mm_r_bytes;
+} trace_stats_reply;
+
+#endif
@@ -0,0 +1,46 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "trace_pack.h"
+#include "trace_reader.h"
+
+/**
+ * Convert a text or binary trace to the packed format
+ */
+int main(int argc, char* argv[])
+{
+    if (argc != 3)
+    {
+        fprintf(stderr, "Usage: %s input_trace output_trace\n", argv[0]);
+        exit(1);
+    }
+    trace_reader* tr = tr_open(argv[1]);
+    if (tr == 0)
+    {
+        fprintf(stderr, "Error: Could not open %s.\n", argv[1]);
+        exit(3);
+    }
+    tp_writer* w = tp_create(argv[2]);
+
+    char RW;
+    void* addr;
+    unsigned int val;
+    int tenant;
+    int status;
+    while ((status = tr_next(tr, &RW, &addr, &val, &tenant)) != TRACE_READ_EOF)
+        if (status == TRACE_READ_ACCESS)
+            tp_append(w, strchr(TRACE_OP_CHARS, RW) - TRACE_OP_CHARS, (uintptr_t) addr, val, tenant);
+    uint64_t records = w->records;
+    tp_finish(w);
+    tr_close(tr);
+
+    struct stat in, out;
+    if (stat(argv[1], &in) == 0 && stat(argv[2], &out) == 0 && out.st_size > 0)
+        printf("%lu records, %lld -> %lld bytes (%.1lfx)\n", (unsigned long) records,
+               (long long) in.st_size, (long long) out.st_size, (double) in.st_size / out.st_size);
+    return 0;
+}
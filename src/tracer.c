@@ -0,0 +1,242 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "tracer.h"
+
+tracer tracer_state;
+
+_Thread_local tracer_ring* tracer_thread_ring;
+
+static FILE* tracer_file;
+static pthread_t tracer_flusher;
+static pthread_once_t tracer_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t tracer_key;
+
+/**
+ * Flusher position in one ring: records from tail up to head were published
+ * when the flush started
+ */
+typedef struct drain_cursor
+{
+    tracer_ring* ring;
+    size_t tail;
+    size_t head;
+} drain_cursor;
+
+static drain_cursor* tracer_cursors;
+static size_t tracer_num_cursors;
+
+/**
+ * Release a ring when its thread exits; unflushed records are still written
+ * and the ring is handed to the next thread that starts tracing
+ * @param arg: ring of the exiting thread
+ */
+static void release_ring(void* arg)
+{
+    tracer_ring* ring = arg;
+    atomic_store_explicit(&ring->in_use, 0, memory_order_release);
+}
+
+static void make_key()
+{
+    pthread_key_create(&tracer_key, release_ring);
+}
+
+/**
+ * Give the calling thread a ring, reusing one left by an exited thread if possible
+ * @return ring, or NULL if out of memory
+ */
+static tracer_ring* claim_ring()
+{
+    pthread_once(&tracer_key_once, make_key);
+    tracer_ring* ring = atomic_load_explicit(&tracer_state.rings, memory_order_acquire);
+    for (; ring != NULL; ring = ring->next)
+    {
+        int expected = 0;
+        if (atomic_compare_exchange_strong(&ring->in_use, &expected, 1))
+        {
+            ring->cached_tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+            break;
+        }
+    }
+    if (ring == NULL)
+    {
+        ring = calloc(1, sizeof(tracer_ring));
+        if (ring == NULL)
+            return NULL;
+        ring->in_use = 1;
+        ring->next = atomic_load_explicit(&tracer_state.rings, memory_order_relaxed);
+        while (!atomic_compare_exchange_weak_explicit(&tracer_state.rings, &ring->next, ring,
+                                                      memory_order_release, memory_order_relaxed));
+    }
+    pthread_setspecific(tracer_key, ring);
+    return ring;
+}
+
+/**
+ * Slow path of trace_emit: first record of a thread or full ring. A full ring
+ * waits for the flusher rather than dropping records.
+ * @param op: record operation
+ * @param addr: accessed address
+ * @param val: value stored
+ */
+void trace_record_slow(uint8_t op, uintptr_t addr, uint32_t val)
+{
+    if (!atomic_load_explicit(&tracer_state.active, memory_order_acquire))
+        return;
+    tracer_ring* ring = tracer_thread_ring;
+    if (ring == NULL)
+    {
+        ring = claim_ring();
+        if (ring == NULL)
+            return;
+        tracer_thread_ring = ring;
+    }
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    ring->cached_tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - ring->cached_tail == TRACER_RING_SIZE)
+    {
+        atomic_fetch_add_explicit(&tracer_state.waits, 1, memory_order_relaxed);
+        do
+        {
+            if (!atomic_load_explicit(&tracer_state.active, memory_order_relaxed))
+                return;
+            sched_yield();
+            ring->cached_tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+        }
+        while (head - ring->cached_tail == TRACER_RING_SIZE);
+    }
+    ring->seqs[head & (TRACER_RING_SIZE - 1)] = atomic_fetch_add_explicit(&tracer_state.seq, 1,
+                                                                          memory_order_relaxed);
+    trace_record* slot = &ring->slots[head & (TRACER_RING_SIZE - 1)];
+    slot->addr = (uint32_t) addr;
+    slot->val = val;
+    slot->op = op;
+    slot->tenant = 0;
+    slot->reserved = 0;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+/**
+ * Write every record currently published in the rings, merged by sequence number
+ * @return number of records written
+ */
+static size_t drain_rings()
+{
+    size_t n = 0;
+    tracer_ring* ring = atomic_load_explicit(&tracer_state.rings, memory_order_acquire);
+    for (; ring != NULL; ring = ring->next, n++)
+    {
+        if (n == tracer_num_cursors)
+        {
+            tracer_num_cursors = tracer_num_cursors ? tracer_num_cursors * 2 : 8;
+            tracer_cursors = realloc(tracer_cursors, tracer_num_cursors * sizeof(drain_cursor));
+        }
+        tracer_cursors[n].ring = ring;
+        tracer_cursors[n].tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        tracer_cursors[n].head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    }
+
+    size_t total = 0;
+    for (;;)
+    {
+        drain_cursor* next = NULL;
+        uint64_t next_seq = 0;
+        for (size_t i = 0; i < n; i++)
+        {
+            drain_cursor* cursor = &tracer_cursors[i];
+            if (cursor->tail == cursor->head)
+                continue;
+            uint64_t seq = cursor->ring->seqs[cursor->tail & (TRACER_RING_SIZE - 1)];
+            if (next == NULL || seq < next_seq)
+            {
+                next = cursor;
+                next_seq = seq;
+            }
+        }
+        if (next == NULL)
+            break;
+        fwrite(&next->ring->slots[next->tail & (TRACER_RING_SIZE - 1)], sizeof(trace_record), 1, tracer_file);
+        next->tail++;
+        total++;
+    }
+
+    for (size_t i = 0; i < n; i++)
+        atomic_store_explicit(&tracer_cursors[i].ring->tail, tracer_cursors[i].tail, memory_order_release);
+    return total;
+}
+
+static void* flush_loop(void* arg)
+{
+    (void) arg;
+    while (atomic_load_explicit(&tracer_state.active, memory_order_acquire))
+        if (drain_rings() == 0)
+            usleep(TRACER_IDLE_US);
+    drain_rings();
+    return NULL;
+}
+
+/**
+ * Start tracing to a binary trace file readable by the simulator. Records emitted
+ * while no trace is open are discarded.
+ * @param path: output file
+ * @return 0 on success, -1 if a trace is already open or the file cannot be written
+ */
+int trace_open(const char* path)
+{
+    if (atomic_load(&tracer_state.active) || tracer_file != NULL)
+    {
+        fprintf(stderr, "Error: A trace is already open.\n");
+        return -1;
+    }
+    tracer_file = fopen(path, "wb");
+    if (tracer_file == NULL)
+    {
+        fprintf(stderr, "Error: Could not open %s.\n", path);
+        return -1;
+    }
+    trace_file_header header = {TRACE_FILE_MAGIC, TRACE_FILE_VERSION, sizeof(trace_record), 0};
+    fwrite(&header, sizeof(header), 1, tracer_file);
+
+    // Drop whatever threads emitted since the previous trace was closed
+    tracer_ring* ring = atomic_load_explicit(&tracer_state.rings, memory_order_acquire);
+    for (; ring != NULL; ring = ring->next)
+        atomic_store_explicit(&ring->tail, atomic_load(&ring->head), memory_order_release);
+    atomic_store(&tracer_state.waits, 0);
+    atomic_store_explicit(&tracer_state.active, 1, memory_order_release);
+    if (pthread_create(&tracer_flusher, NULL, flush_loop, NULL) != 0)
+    {
+        atomic_store(&tracer_state.active, 0);
+        fclose(tracer_file);
+        tracer_file = NULL;
+        fprintf(stderr, "Error: Could not start the trace flusher.\n");
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Stop tracing, write the remaining records and close the file. Rings stay
+ * allocated so running threads never see a freed buffer.
+ */
+void trace_close(void)
+{
+    if (tracer_file == NULL)
+        return;
+    atomic_store_explicit(&tracer_state.active, 0, memory_order_release);
+    pthread_join(tracer_flusher, NULL);
+    uint64_t waits = atomic_load(&tracer_state.waits);
+    if (waits > 0)
+        fprintf(stderr, "Warning: Tracing threads waited on a full ring %llu times.\n",
+                (unsigned long long) waits);
+    fclose(tracer_file);
+    tracer_file = NULL;
+    free(tracer_cursors);
+    tracer_cursors = NULL;
+    tracer_num_cursors = 0;
+}
@@ -0,0 +1,134 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "trace_record.h"
+
+// Records per thread ring; a power of two so positions wrap with a mask
+#define TRACER_RING_SIZE 65536
+
+// Flusher sleep when no ring had records, in microseconds
+#define TRACER_IDLE_US 1000
+
+typedef struct tracer_ring
+{
+    // Written by the producing thread only
+    _Atomic size_t head;
+    size_t cached_tail;
+    char pad0[64 - sizeof(size_t) * 2];
+    // Written by the flusher only
+    _Atomic size_t tail;
+    char pad1[64 - sizeof(size_t)];
+    _Atomic int in_use;
+    struct tracer_ring* next;
+    trace_record slots[TRACER_RING_SIZE];
+    // Global sequence number of each slot, used by the flusher to merge rings
+    uint64_t seqs[TRACER_RING_SIZE];
+} tracer_ring;
+
+/**
+ * Tracing state shared by all threads. Every record takes the next number of
+ * seq, and each flush merges the records published in all rings by number, so
+ * the trace follows the order in which threads emitted them. A record whose
+ * thread was between taking its number and publishing it when a flush started
+ * is written in the next flush, slightly out of order.
+ */
+typedef struct tracer
+{
+    _Atomic uint64_t seq;
+    char pad[64 - sizeof(uint64_t)];
+    _Atomic int active;
+    _Atomic(tracer_ring*) rings;
+    _Atomic uint64_t waits;
+} tracer;
+
+extern tracer tracer_state;
+
+int trace_open(const char* path);
+
+void trace_record_slow(uint8_t op, uintptr_t addr, uint32_t val);
+
+void trace_close(void);
+
+extern _Thread_local tracer_ring* tracer_thread_ring;
+
+/**
+ * Append one record to the calling thread's ring
+ * @param op: TRACE_OP_* value
+ * @param addr: accessed address, truncated to 32 bits
+ * @param val: value stored
+ */
+static inline void trace_emit(uint8_t op, uintptr_t addr, uint32_t val)
+{
+    tracer_ring* ring = tracer_thread_ring;
+    if (ring == NULL)
+    {
+        trace_record_slow(op, addr, val);
+        return;
+    }
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    if (head - ring->cached_tail == TRACER_RING_SIZE)
+    {
+        trace_record_slow(op, addr, val);
+        return;
+    }
+    ring->seqs[head & (TRACER_RING_SIZE - 1)] = atomic_fetch_add_explicit(&tracer_state.seq, 1,
+                                                                          memory_order_relaxed);
+    trace_record* slot = &ring->slots[head & (TRACER_RING_SIZE - 1)];
+    slot->addr = (uint32_t) addr;
+    slot->val = val;
+    slot->op = op;
+    slot->tenant = 0;
+    slot->reserved = 0;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+static inline void trace_load(const void* addr)
+{
+    trace_emit(TRACE_OP_READ, (uintptr_t) addr, 0);
+}
+
+static inline void trace_store(const void* addr, uint32_t val)
+{
+    trace_emit(TRACE_OP_WRITE, (uintptr_t) addr, val);
+}
+
+static inline void trace_fetch(const void* addr)
+{
+    trace_emit(TRACE_OP_FETCH, (uintptr_t) addr, 0);
+}
+
+static inline void trace_nt_load(const void* addr)
+{
+    trace_emit(TRACE_OP_NT_READ, (uintptr_t) addr, 0);
+}
+
+static inline void trace_nt_store(const void* addr, uint32_t val)
+{
+    trace_emit(TRACE_OP_NT_WRITE, (uintptr_t) addr, val);
+}
+
+static inline void trace_clean(const void* addr)
+{
+    trace_emit(TRACE_OP_CLEAN, (uintptr_t) addr, 0);
+}
+
+static inline void trace_invalidate(const void* addr)
+{
+    trace_emit(TRACE_OP_INVALIDATE, (uintptr_t) addr, 0);
+}
+
+static inline void trace_clean_invalidate(const void* addr)
+{
+    trace_emit(TRACE_OP_CLEAN_INVALIDATE, (uintptr_t) addr, 0);
+}
+
+static inline void trace_flush(void)
+{
+    trace_emit(TRACE_OP_FLUSH, 0, 0);
+}
+
+#endif
@@ -0,0 +1,150 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "ucp.h"
+
+/**
+ * Allocate utility monitors: one shadow tag directory per tenant, kept as a
+ * full LRU stack per set, with a hit counter per stack position
+ * @param num_tenants: number of tenants monitored
+ * @param num_sets: number of sets in the monitored cache
+ * @param num_ways: associativity of the monitored cache
+ * @param interval: accesses between two repartitions
+ * @return initialized monitor, with ways split evenly between tenants
+ */
+ucp_monitor* ucp_init(int num_tenants, int num_sets, int num_ways, unsigned int interval)
+{
+    ucp_monitor* result = malloc(sizeof(ucp_monitor));
+    result->num_tenants = num_tenants;
+    result->num_sets = num_sets;
+    result->num_ways = num_ways;
+    result->interval = interval;
+    result->accesses = 0;
+    result->repartitions = 0;
+    result->tags = malloc(num_tenants * num_sets * num_ways * sizeof(uint32_t));
+    result->depth = calloc(num_tenants * num_sets, sizeof(int));
+    result->hits = calloc(num_tenants * num_ways, sizeof(unsigned int));
+    result->queries = calloc(num_tenants, sizeof(unsigned int));
+    result->alloc = malloc(num_tenants * sizeof(int));
+    for (int t = 0; t < num_tenants; t++)
+        result->alloc[t] = num_ways / num_tenants + (t < num_ways % num_tenants);
+    return result;
+}
+
+/**
+ * Record an access in the tenant's shadow tags
+ * @param u: pointer to monitor
+ * @param tenant: tenant issuing the access
+ * @param set_index: set the access maps to
+ * @param block: block number accessed
+ * @return 1 if the interval elapsed and u->alloc was recomputed, 0 otherwise
+ */
+int ucp_access(ucp_monitor* u, int tenant, int set_index, uint32_t block)
+{
+    uint32_t* stack = u->tags + (tenant * u->num_sets + set_index) * u->num_ways;
+    int* depth = &u->depth[tenant * u->num_sets + set_index];
+    u->queries[tenant]++;
+
+    int pos = 0;
+    while (pos < *depth && stack[pos] != block)
+        pos++;
+
+    // A hit at stack position pos would hit in any allocation of more than pos ways
+    if (pos < *depth)
+        u->hits[tenant * u->num_ways + pos]++;
+    else if (*depth < u->num_ways)
+        (*depth)++;
+    else
+        pos = u->num_ways - 1;
+
+    memmove(stack + 1, stack, pos * sizeof(uint32_t));
+    stack[0] = block;
+
+    if (++u->accesses % u->interval != 0)
+        return 0;
+    ucp_partition(u);
+    return 1;
+}
+
+/**
+ * Marginal utility of giving a tenant extra ways on top of its allocation
+ * @param u: pointer to monitor
+ * @param tenant: tenant
+ * @param have: ways already allocated
+ * @param extra: additional ways
+ * @return extra hits per additional way
+ */
+static double marginal_utility(ucp_monitor* u, int tenant, int have, int extra)
+{
+    unsigned int gained = 0;
+    for (int w = have; w < have + extra; w++)
+        gained += u->hits[tenant * u->num_ways + w];
+    return (double) gained / extra;
+}
+
+/**
+ * Recompute way allocation with the lookahead algorithm: repeatedly grant the
+ * block of ways with the highest marginal utility. Tenants that issued accesses
+ * get at least one way while ways remain; counters are halved afterwards so
+ * the monitor follows phase changes
+ * @param u: pointer to monitor
+ */
+void ucp_partition(ucp_monitor* u)
+{
+    int balance = u->num_ways;
+    for (int t = 0; t < u->num_tenants; t++)
+    {
+        u->alloc[t] = u->queries[t] > 0 && balance > 0;
+        balance -= u->alloc[t];
+    }
+
+    while (balance > 0)
+    {
+        int best_tenant = -1, best_extra = 0;
+        double best_utility = -1;
+        for (int t = 0; t < u->num_tenants; t++)
+        {
+            if (u->queries[t] == 0)
+                continue;
+            for (int k = 1; k <= balance; k++)
+            {
+                double mu = marginal_utility(u, t, u->alloc[t], k);
+                if (mu > best_utility)
+                {
+                    best_utility = mu;
+                    best_tenant = t;
+                    best_extra = k;
+                }
+            }
+        }
+
+        // Nobody issued accesses: leave remaining ways to tenant 0
+        if (best_tenant == -1)
+        {
+            best_tenant = 0;
+            best_extra = balance;
+        }
+        u->alloc[best_tenant] += best_extra;
+        balance -= best_extra;
+    }
+
+    for (int i = 0; i < u->num_tenants * u->num_ways; i++)
+        u->hits[i] /= 2;
+    for (int t = 0; t < u->num_tenants; t++)
+        u->queries[t] /= 2;
+    u->repartitions++;
+}
+
+/**
+ * Free memory allocated to monitor
+ * @param u: pointer to monitor
+ */
+void ucp_free(ucp_monitor* u)
+{
+    free(u->tags);
+    free(u->depth);
+    free(u->hits);
+    free(u->queries);
+    free(u->alloc);
+    free(u);
+}
@@ -0,0 +1,29 @@
+#ifndef UCP_H
+#define UCP_H
+
+#include <stdint.h>
+
+typedef struct ucp_monitor
+{
+    int num_tenants;
+    int num_sets;
+    int num_ways;
+    unsigned int interval;
+    unsigned int accesses;
+    unsigned int repartitions;
+    uint32_t* tags;
+    int* depth;
+    unsigned int* hits;
+    unsigned int* queries;
+    int* alloc;
+} ucp_monitor;
+
+ucp_monitor* ucp_init(int num_tenants, int num_sets, int num_ways, unsigned int interval);
+
+int ucp_access(ucp_monitor* u, int tenant, int set_index, uint32_t block);
+
+void ucp_partition(ucp_monitor* u);
+
+void ucp_free(ucp_monitor* u);
+
+#endif
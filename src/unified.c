@@ -0,0 +1,125 @@
+#include <stdlib.h>
+#include <stdio.h>
+
+#include "unified.h"
+#include "main_memory.h"
+
+/**
+ * Allocate a unified lower-level cache shared by the L1 caches
+ * Only tags are kept: data always lives in main memory, so the level
+ * decides which L1 fills and write backs actually reach memory
+ * @param num_sets: number of sets (power of two), 1 for fully associative
+ * @param num_ways: lines per set, 1 for direct mapped
+ * @return initialized cache
+ */
+unified_cache* unified_init(int num_sets, int num_ways)
+{
+    unified_cache* result = calloc(1, sizeof(unified_cache));
+    result->num_sets = num_sets;
+    result->num_ways = num_ways;
+    result->lines = calloc(num_sets * num_ways, sizeof(unified_line));
+    return result;
+}
+
+/**
+ * Look up a block on an L1 fill or write back, allocating it on a miss
+ * Write backs carry the full block, so a write miss allocates without a fetch
+ * @param u: pointer to cache
+ * @param start_addr: start address of memory block
+ * @param is_write: 1 for an L1 write back, 0 for an L1 fill
+ * @param victim: set to the start address of an evicted dirty block, NULL if none
+ * @return 1 if the block had to be read from main memory, 0 otherwise
+ */
+int unified_access(unified_cache* u, void* start_addr, int is_write, void** victim)
+{
+    uint32_t block = (uint32_t) (uintptr_t) start_addr >> MAIN_MEMORY_BLOCK_SIZE_LN;
+    unified_line* set = u->lines + (block & (u->num_sets - 1)) * u->num_ways;
+    *victim = NULL;
+
+    if (is_write)
+        u->wb_queries++;
+    else
+        u->fill_queries++;
+
+    int way = -1;
+    for (int i = 0; i < u->num_ways; i++)
+    {
+        if (set[i].is_valid && set[i].block == block)
+        {
+            way = i;
+            break;
+        }
+    }
+
+    int fetched = 0;
+    if (way == -1)
+    {
+        // Replace an invalid or the least recently used line
+        way = 0;
+        for (int i = 0; i < u->num_ways; i++)
+        {
+            if (!set[i].is_valid)
+            {
+                way = i;
+                break;
+            }
+            if (set[i].usage > set[way].usage)
+                way = i;
+        }
+
+        if (set[way].is_valid && set[way].is_dirty)
+        {
+            *victim = (void*) ((uintptr_t) set[way].block << MAIN_MEMORY_BLOCK_SIZE_LN);
+            u->mem_writes++;
+        }
+        set[way].is_valid = 1;
+        set[way].is_dirty = 0;
+        set[way].block = block;
+
+        if (is_write)
+            u->wb_misses++;
+        else
+        {
+            u->fill_misses++;
+            u->mem_reads++;
+            fetched = 1;
+        }
+    }
+
+    for (int i = 0; i < u->num_ways; i++)
+        set[i].usage++;
+    set[way].usage = 0;
+    if (is_write)
+        set[way].is_dirty = 1;
+    return fetched;
+}
+
+/**
+ * Print lower-level statistics
+ * @param u: pointer to cache
+ */
+void unified_print(unified_cache* u)
+{
+    unsigned int fill_hits = u->fill_queries - u->fill_misses;
+    unsigned int wb_hits = u->wb_queries - u->wb_misses;
+    printf("L2 Geometry:\t\t%d sets x %d ways\n", u->num_sets, u->num_ways);
+    printf("L2 Fill Hit Rate:\t%.0lf%% (%u/%u)\n",
+           u->fill_queries ? (double) fill_hits / u->fill_queries * 100 : 0,
+           fill_hits, u->fill_queries);
+    printf("L2 Write Back Hits:\t%.0lf%% (%u/%u)\n",
+           u->wb_queries ? (double) wb_hits / u->wb_queries * 100 : 0,
+           wb_hits, u->wb_queries);
+    printf("Memory Reads:\t\t%u\n", u->mem_reads);
+    printf("Memory Writes:\t\t%u\n", u->mem_writes);
+    printf("*******************************************\n");
+}
+
+/**
+ * Free memory allocated to cache
+ * @param u: pointer to cache
+ */
+void unified_free(unified_cache* u)
+{
+    free(u->lines);
+    free(u);
+}
@@ -0,0 +1,36 @@
+#ifndef UNIFIED_H
+#define UNIFIED_H
+
+#include <stdint.h>
+
+typedef struct unified_line
+{
+    int is_valid;
+    int is_dirty;
+    uint32_t block;
+    float usage;
+} unified_line;
+
+typedef struct unified_cache
+{
+    int num_sets;
+    int num_ways;
+    unified_line* lines;
+
+    unsigned int fill_queries;
+    unsigned int fill_misses;
+    unsigned int wb_queries;
+    unsigned int wb_misses;
+    unsigned int mem_reads;
+    unsigned int mem_writes;
+} unified_cache;
+
+unified_cache* unified_init(int num_sets, int num_ways);
+
+int unified_access(unified_cache* u, void* start_addr, int is_write, void** victim);
+
+void unified_print(unified_cache* u);
+
+void unified_free(unified_cache* u);
+
+#endif